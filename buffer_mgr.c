@@ -1,37 +1,762 @@
 #include "storage_mgr.h"
 #include "buffer_mgr.h"
 #include "buffer_mgr_stat.h"
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
  
 //global vars
 
 #define QUEUE_EMPTY 0
 
+// number of evicted pages that may be written back asynchronously at once
+#define WRITE_BACK_DEPTH 32
+
+// the page table is split into this many independently latched shards
+#define PAGE_TABLE_SHARDS 16
+
+// buckets of page numbers whose evictions are counted, see read_frame
+#define EVICT_STAMPS 64
+
+// the background writer writes at most WRITER_BATCH pages per hold of the
+// pool latch, and looks at the dirty ratio at least every WRITER_PERIOD_MS
+#define WRITER_BATCH 8
+#define WRITER_PERIOD_MS 50
+
+// longest run of pages a scan ring reads ahead with one vectored read
+#define READ_AHEAD_RUN 16
+
+// number of pages prefetchPages may be reading asynchronously at once
+#define PREFETCH_DEPTH 32
+
+// page buffers the pool holds beyond one per frame: pages on their way to
+// disk, pages being read before they replace a frame and prefetched pages
+#define SPARE_PAGES (WRITE_BACK_DEPTH + READ_AHEAD_RUN + PREFETCH_DEPTH)
+
+// LFU reference counts saturate at LFU_MAX_COUNT, and all counts are halved
+// after LFU_AGING_PERIOD pins per frame of the pool
+#define LFU_MAX_COUNT 64
+#define LFU_AGING_PERIOD 8
+
+// number of references LRU-K tracks per page when stratData does not set K
+#define LRU_K_DEFAULT 2
+
+// ARC list pairs, T1/B1 hold pages referenced once recently and T2/B2 pages
+// referenced at least twice
+#define ARC_RECENT 0
+#define ARC_FREQUENT 1
+
+// events note_frame records for the replacement strategy: a hit, a client
+// releasing the last pin of a page, and the pool releasing a frame it held
+// for a write
+#define NOTE_HIT 0
+#define NOTE_UNPIN 1
+#define NOTE_RELEASE 2
+
+// pages are keyed by the file they belong to and their page number, so one
+// pool can cache several files
+typedef long long Page_Key;
+#define NO_KEY -1
+
 typedef struct Page_Frame{
 	PageNumber page_num;  // page number of the frame
+	int file_id;          // pool file the page belongs to
 	int page_dirty;       // indicates that this page is modified
 	int fix_count;        // how many users are currently reading this page
 	int num_hit;        // how many users are currently reading this page
 	SM_PageHandle contents;       // data-contents of the page
+	int prev, next;       // neighbours in the LRU list or LFU bucket, -1 at the ends
+	int ref_bit;          // CLOCK reference bit, set on every pin
+	int arc_list;         // ARC list holding the frame, ARC_RECENT or ARC_FREQUENT
+	int listed;           // frame is on the LRU list or in an LFU bucket
+	int prefetched;       // placed by prefetchPages and not pinned since
+
+	// hits and unpins since the strategy last looked at the frame, guarded by
+	// the shard latch of its page, see note_frame
+	int touched;          // frame is on the touched list of its shard
+	int touched_prev, touched_next;   // neighbours on that list, -1 at the ends
+	int new_hits;         // hits not folded into the strategy yet
+	long ref_stamp;       // reference clock at the latest hit or unpin that orders the frame, 0 for none
 } Page_Frame;
 
-typedef struct {
+typedef struct Table_Slot{
+	Page_Key key;         // page stored in the slot
+	int index;            // frame or history entry of the page, -1 if the slot is empty
+} Table_Slot;
+
+typedef struct Page_Table{
+	Table_Slot *slots;    // open-addressing hash table from page key to index
+	int mask;             // number of slots - 1, the number of slots is a power of two
+	int num_used;         // slots holding an entry, at most half of them
+} Page_Table;
+
+typedef struct Page_Shard{
+	pthread_mutex_t latch;  // guards the table and pins of the pages hashed to it
+	Page_Table table;       // page key to frame index for those pages
+	int touched;            // first frame of those pages hit or unpinned since the last fold, -1 if none
+} Page_Shard;
+
+// a frame fold_references takes from a touched list
+typedef struct Touched_Frame{
+	long stamp;           // ref_stamp of the frame when it was taken
+	int frame;            // index of the frame
+	int hits;             // its hits since the previous fold
+} Touched_Frame;
+
+typedef struct Frame_List{
+	int head, tail;       // first and last frame of a list threaded through prev/next
+} Frame_List;
+
+typedef struct Ghost_Entry{
+	Page_Key key;         // page that was evicted
+	int list;             // ghost list holding the entry, ARC_RECENT or ARC_FREQUENT
+	int prev, next;       // neighbours in the ghost list or the free list, -1 at the ends
+} Ghost_Entry;
+
+// a page file attached to a pool through BM_BufferPool handles. A private
+// pool has one, a shared pool one per page file: handles that open the same
+// file, by device and inode, share it and its cached pages. File ids are never
+// reused, so pages a detached file leaves behind are never hit again and age
+// out.
+typedef struct Pool_File{
+	struct Queue *pool;           // pool caching the pages of the file
+	int file_id;                  // tags the pages of the file in the pool
+	SM_FileHandle fh;             // page file, open while the file is attached
+	RC write_error;               // an evicted page of the file could not be written, see write_back_failed
+	bool on_disk;                 // the file has a device and inode, false for files the backend keeps in memory
+	dev_t dev;                    // device and inode of the page file
+	ino_t ino;
+	int num_handles;              // handles the file is attached through, guarded by the pool latch
+	struct Pool_File *next;       // next file attached to the same pool
+} Pool_File;
+
+// a mapping of page buffers added when the pool grew beyond its arena
+typedef struct Arena_Extent{
+	char *base;
+	size_t size;
+	struct Arena_Extent *next;
+} Arena_Extent;
+
+typedef struct Pending_Write{
+	Pool_File *file;              // file the page is written to
+	PageNumber page_num;          // page being written back
+	SM_PageHandle contents;       // evicted contents, returned to the free pages once the write completes
+	int started;                  // a deferred write some thread is performing, see write_deferred
+} Pending_Write;
+
+typedef struct Pending_Read{
+	Pool_File *file;              // file the page is read from
+	PageNumber page_num;          // page being prefetched
+	SM_PageHandle contents;       // free page the read fills, placed in a frame once the read completes
+	unsigned int stamp;           // evict stamp of the page when the read started
+} Pending_Read;
+
+// pages a scan placed in the pool, see initScanRing
+typedef struct Scan_Ring{
+	Page_Key *keys;               // page of every slot, NO_KEY while the slot is unused
+	int size;                     // number of slots
+	int next;                     // slot that is reused next, the oldest one
+} Scan_Ring;
+
+typedef struct Queue {
     Page_Frame *Page_Frame; 
     int head, tail, num_entries, max_entries, num_files_written, num_files_read;
+
+    // evicted frames that were dropped and that had to be written back
+    int num_clean_evictions, num_dirty_evictions;
+
+    // hash table from page number to frame index, split into shards with a
+    // latch each so hits on different pages do not contend
+    Page_Shard shards[PAGE_TABLE_SHARDS];
+
+    // guards the replacement state, the free pages, the write-backs, the page
+    // file handle and the counters. Latch order: pool_latch first, then a
+    // shard or a frame latch. No page is read or written while it is held.
+    pthread_mutex_t pool_latch;
+
+    // one latch per frame, orders marking a page dirty against writing it out
+    pthread_mutex_t *frame_latches;
+
+    // reads and writes outside pool_latch hold this shared, growing the file exclusive
+    pthread_rwlock_t file_latch;
+
+    // evictions per bucket of page numbers, a read that raced one is repeated
+    unsigned int evict_stamps[EVICT_STAMPS];
+
+    // logical time of the latest hit or unpin, advanced atomically without
+    // any latch. Orders the touched frames when they are folded.
+    long ref_clock;
+
+    // frames fold_references takes from the touched lists, one per frame
+    Touched_Frame *touched_frames;
+
+    // frames whose page_dirty is set, changed atomically under the frame latches
+    int num_dirty;
+
+    // background writer, see startBackgroundWriter
+    pthread_t writer_thread;
+    pthread_mutex_t writer_latch;   // guards starting and stopping the thread, and the wake-ups
+    pthread_cond_t writer_wake;
+    int writer_running;             // the thread exists
+    int writer_stop;                // asks the thread to exit
+    int writer_threshold;           // dirty frames that start a trickle, 0 while stopped
+    int writer_percent;             // share of the frames writer_threshold stands for
+    int *writer_order;              // frames in the order the writer cleans them
+
+    // LRU recency list of unpinned frames, most recent first
+    Frame_List lru;
+
+    // LFU buckets of unpinned frames by reference count, most recent first
+    Frame_List lfu_buckets[LFU_MAX_COUNT + 1];
+    int lfu_min;        // no bucket below this one holds a frame
+    int lfu_ticks;      // pins since the counts were last aged
+
+    // frame the CLOCK hand points at
+    int clock_hand;
+
+    // LRU-K reference history, only allocated for RS_LRU_K pools
+    int lru_k;                  // number of references tracked per page, stamped by ref_clock
+    long *frame_times;          // last K reference times of every frame, most recent first
+    long *hit_times;            // last K times of the hits not folded yet, guarded like new_hits
+    int *heap;                  // unpinned frames, the next victim first
+    int *heap_pos;              // position of every frame in 'heap', -1 if it is not in it
+    int heap_size;
+    Page_Key *retained_keys;    // recently evicted pages whose history is kept
+    long *retained_times;       // their last K reference times
+    int retained_next;          // retained slot that is overwritten next
+    Page_Table retained_table;  // page key to retained slot
+
+    // ARC lists, ghosts are only allocated for RS_ARC pools
+    Frame_List arc_lists[2];    // resident frames, pinned or not, most recent first
+    int arc_sizes[2];
+    int arc_target;             // size of the recent list ARC currently aims for
+    Ghost_Entry *ghosts;        // pages evicted from the resident lists
+    Frame_List ghost_lists[2];  // ghost entries, most recent first
+    int ghost_sizes[2];
+    int ghost_free;             // first unused ghost entry, chained through next
+    Page_Table ghost_table;     // page key to ghost entry
+
+    // every page buffer of the pool lives in one mapping, frames swap buffers
+    // with the free pages instead of allocating them
+    char *arena;
+    size_t arena_size;
+    SM_PageHandle *free_pages;  // arena pages neither a frame nor a write-back holds
+    int num_free_pages;
+
+    // page buffers of a resized pool. Growing maps extents beyond the arena,
+    // shrinking hands buffers back to the system and keeps their addresses
+    // for the next time the pool grows.
+    int num_pages;              // buffers the pool owns, room for all of them in free_pages
+    Arena_Extent *extents;
+    SM_PageHandle *retired_pages;
+    int num_retired_pages;
+
+    // files whose pages the pool caches, and the id the next one gets
+    Pool_File *files;
+    int next_file_id;
+
+    // strategy every handle of the pool uses
+    ReplacementStrategy strategy;
+
+    // the pool outlives its handles, see initSharedBufferPool
+    int shared;
+
+    // asynchronous write-back of evicted frames, started by the first write-back
+    SM_AsyncQueue write_queue;
+    Pending_Write pending[WRITE_BACK_DEPTH];
+    int num_pending;
+
+    // write-backs the engine could not take, performed outside the pool latch
+    // by the next thread that releases it, see write_back_later
+    Pending_Write *deferred;
+    int num_deferred;
+    int deferred_size;
+    pthread_cond_t deferred_done;
+
+    // asynchronous reads of prefetched pages, see prefetchPages, started by the
+    // first prefetch. Misses read the count without the pool latch, it changes
+    // atomically under it.
+    SM_AsyncQueue read_queue;
+    Pending_Read prefetches[PREFETCH_DEPTH];
+    int num_prefetches;
 } Queue; 
 
+// the pool openSharedBufferPool attaches files to, NULL while there is none
+static Queue *shared_pool = NULL;
+static pthread_mutex_t shared_pool_latch = PTHREAD_MUTEX_INITIALIZER;
 
-// NAME: initBufferPool
-// PURPOSE: initialize all elements of the buffer pool
+
+// NAME: table_init
+// PURPOSE: allocate an empty page table for up to 'num_entries' pages. The
+// table size is a power of two at least twice that, so probe sequences stay
+// short.
 // PARAMS: 
-// - bm: buffer pool 
-// - pageFileName: name of the file we will be writing to
-// - numPages: number of pages in our buffer pool
+// - table: page table to initialize
+// - num_entries: number of pages the table must hold
+// RETURN VAL: none
+static void table_init(Page_Table *table, int num_entries){
+
+	int table_size = 8;
+
+	while(table_size < num_entries * 2){
+		table_size *= 2;
+	}
+	table->slots = malloc(sizeof(Table_Slot)*table_size);
+	table->mask = table_size - 1;
+	table->num_used = 0;
+	for(int i = 0; i < table_size; i++){
+		table->slots[i].index = -1;
+	}
+}
+
+// NAME: page_key
+// PURPOSE: key of a page of a pool file in the tables of the pool
+// PARAMS: 
+// - file_id: id of the pool file
+// - pageNum: page number in the file
+// RETURN VAL: the key
+static Page_Key page_key(int file_id, PageNumber pageNum){
+	return ((Page_Key)file_id << 32) | (unsigned int)pageNum;
+}
+
+// NAME: mix_key
+// PURPOSE: scramble a page key for hashing. Keys of the first file are their
+// page numbers.
+// PARAMS: 
+// - key: page key
+// RETURN VAL: hash of the key
+static unsigned int mix_key(Page_Key key){
+	return (unsigned int)(key ^ (key >> 32)) * 2654435761u;
+}
+
+// NAME: hash_page
+// PURPOSE: home slot of a page key in a page table
+// PARAMS: 
+// - table: page table
+// - key: page key to hash
+// RETURN VAL: index into the page table
+static int hash_page(Page_Table *table, Page_Key key){
+	return (int)(mix_key(key) & (unsigned int)table->mask);
+}
+
+// NAME: table_find
+// PURPOSE: look up the entry stored for a page
+// PARAMS: 
+// - table: page table
+// - key: page to look up
+// RETURN VAL: stored index, -1 if the page is not in the table
+static int table_find(Page_Table *table, Page_Key key){
+
+	int slot = hash_page(table, key);
+
+	// probe until the page or an empty slot turns up
+	while(table->slots[slot].index != -1){
+		if(table->slots[slot].key == key){
+			return table->slots[slot].index;
+		}
+		slot = (slot + 1) & table->mask;
+	}
+	return -1;
+}
+
+// NAME: table_insert
+// PURPOSE: store an index under a page that is not in the table yet. A table
+// that would get more than half full doubles first.
+// PARAMS: 
+// - table: page table
+// - key: page to add
+// - index: index to store
+// RETURN VAL: none
+static void table_insert(Page_Table *table, Page_Key key, int index){
+
+	Table_Slot *old_slots = table->slots;
+	int old_size = table->mask + 1;
+	int slot;
+
+	if((table->num_used + 1) * 2 > old_size){
+		table_init(table, old_size);
+		for(int i = 0; i < old_size; i++){
+			if(old_slots[i].index != -1){
+				table_insert(table, old_slots[i].key, old_slots[i].index);
+			}
+		}
+		free(old_slots);
+	}
+
+	slot = hash_page(table, key);
+	while(table->slots[slot].index != -1){
+		slot = (slot + 1) & table->mask;
+	}
+	table->slots[slot].key = key;
+	table->slots[slot].index = index;
+	table->num_used++;
+}
+
+// NAME: table_remove
+// PURPOSE: drop a page from a page table. Later entries of the probe sequence
+// are shifted back into the hole, so no tombstones are needed.
+// PARAMS: 
+// - table: page table
+// - key: page to drop
+// RETURN VAL: none
+static void table_remove(Page_Table *table, Page_Key key){
+
+	int hole = hash_page(table, key);
+	int slot;
+	int home;
+
+	while(table->slots[hole].index == -1 || table->slots[hole].key != key){
+		if(table->slots[hole].index == -1){
+			return;
+		}
+		hole = (hole + 1) & table->mask;
+	}
+
+	// move back every entry whose home slot does not lie between the hole and itself
+	for(slot = (hole + 1) & table->mask; table->slots[slot].index != -1; slot = (slot + 1) & table->mask){
+		home = hash_page(table, table->slots[slot].key);
+		if(((slot - home) & table->mask) >= ((slot - hole) & table->mask)){
+			table->slots[hole] = table->slots[slot];
+			hole = slot;
+		}
+	}
+	table->slots[hole].index = -1;
+	table->num_used--;
+}
+
+// NAME: shard_entries
+// PURPOSE: number of pages a page table shard is sized for up front, its
+// share of the pool with a quarter on top for pages that hash unevenly
+// PARAMS: 
+// - numPages: number of frames in the pool
+// RETURN VAL: number of pages
+static int shard_entries(int numPages){
+	return numPages / PAGE_TABLE_SHARDS + numPages / (PAGE_TABLE_SHARDS * 4) + 1;
+}
+
+// NAME: shard_of
+// PURPOSE: find the page table shard a page belongs to
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - key: page key
+// RETURN VAL: the shard
+static Page_Shard *shard_of(Queue *q, Page_Key key){
+	return &q->shards[(mix_key(key) >> 16) % PAGE_TABLE_SHARDS];
+}
+
+// NAME: frame_key
+// PURPOSE: key of the page a frame holds
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// RETURN VAL: the key
+static Page_Key frame_key(Queue *q, int frame){
+	return page_key(q->Page_Frame[frame].file_id, q->Page_Frame[frame].page_num);
+}
+
+// NAME: evict_stamp
+// PURPOSE: eviction counter of the bucket a page belongs to, see read_frame
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - key: page key
+// RETURN VAL: the counter
+static unsigned int *evict_stamp(Queue *q, Page_Key key){
+	return &q->evict_stamps[mix_key(key) % EVICT_STAMPS];
+}
+
+// NAME: pool_of
+// PURPOSE: pool behind a buffer pool handle
+// PARAMS: 
+// - bm: active buffer pool
+// RETURN VAL: queue of the pool, shared by every handle of a shared pool
+static Queue *pool_of(BM_BufferPool *const bm){
+	return ((Pool_File *)bm->mgmtData)->pool;
+}
+
+// NAME: pool_file
+// PURPOSE: look up a file attached to a pool, the pool latch is held
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file_id: id of the file
+// RETURN VAL: the file, NULL if it was detached
+static Pool_File *pool_file(Queue *q, int file_id){
+
+	Pool_File *file = q->files;
+
+	while(file != NULL && file->file_id != file_id){
+		file = file->next;
+	}
+	return file;
+}
+
+// NAME: frame_pinned
+// PURPOSE: check whether a frame is pinned. Fix counts change under shard
+// latches only, so they are read atomically.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// RETURN VAL: true if at least one client holds the frame
+static bool frame_pinned(Queue *q, int frame){
+	return __atomic_load_n(&q->Page_Frame[frame].fix_count, __ATOMIC_ACQUIRE) > 0;
+}
+
+// NAME: set_dirty
+// PURPOSE: set or clear the dirty flag of a frame and keep the count of dirty
+// frames the background writer watches. The caller holds the frame latch.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// - dirty: new value of the flag, 0 or 1
+// RETURN VAL: number of dirty frames after the change
+static int set_dirty(Queue *q, int frame, int dirty){
+
+	int delta = dirty - (q->Page_Frame[frame].page_dirty != 0);
+
+	q->Page_Frame[frame].page_dirty = dirty;
+	return __atomic_add_fetch(&q->num_dirty, delta, __ATOMIC_RELAXED);
+}
+
+// NAME: find_frame
+// PURPOSE: look up the frame holding a page. The answer only stays valid while
+// the caller holds a pin on the page or the pool latch.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - key: page to look up
+// RETURN VAL: frame index, -1 if the page is not in the pool
+static int find_frame(Queue *q, Page_Key key){
+
+	Page_Shard *shard = shard_of(q, key);
+	int frame;
+
+	pthread_mutex_lock(&shard->latch);
+	frame = table_find(&shard->table, key);
+	pthread_mutex_unlock(&shard->latch);
+	return frame;
+}
+
+// NAME: next_stamp
+// PURPOSE: advance the reference clock of a pool. Hits and unpins stamp the
+// frames they touch with it without holding a latch other threads share.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: the new time
+static long next_stamp(Queue *q){
+	return __atomic_add_fetch(&q->ref_clock, 1, __ATOMIC_RELAXED);
+}
+
+// NAME: note_frame
+// PURPOSE: record a hit or an unpin of a frame for the replacement strategy
+// without taking the pool latch. The frame joins the touched list of its
+// shard, and LRU, LFU, LRU-K and ARC fold what happened into their state the
+// next time they look at it, see fold_references. FIFO keeps no state for
+// hits and CLOCK only needs the reference bit. The shard latch is held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - shard: shard of the page the frame holds
+// - frame: index of the frame
+// - event: NOTE_HIT, NOTE_UNPIN or NOTE_RELEASE
+// RETURN VAL: none
+static void note_frame(Queue *q, Page_Shard *shard, int frame, int event){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+	long *times;
+
+	if(q->strategy == RS_FIFO || q->strategy == RS_CLOCK){
+		return;
+	}
+
+	// ARC and LRU-K order frames by their hits, LRU by the unpins of its
+	// clients and LFU, which ages its counts every so many hits, by both.
+	// ARC keeps pinned frames on its lists, unpins do not concern it.
+	if(event == NOTE_HIT){
+		pf->new_hits++;
+		if(q->strategy != RS_LRU){
+			pf->ref_stamp = next_stamp(q);
+		}
+		if(q->strategy == RS_LRU_K){
+			times = &q->hit_times[(size_t)frame * q->lru_k];
+			memmove(times + 1, times, sizeof(long) * (q->lru_k - 1));
+			times[0] = pf->ref_stamp;
+		}
+	}
+	else if(event == NOTE_UNPIN && (q->strategy == RS_LRU || q->strategy == RS_LFU)){
+		pf->ref_stamp = next_stamp(q);
+	}
+	else if(q->strategy == RS_ARC){
+		return;
+	}
+
+	if(!pf->touched){
+		pf->touched = 1;
+		pf->touched_prev = -1;
+		pf->touched_next = shard->touched;
+		if(shard->touched != -1){
+			q->Page_Frame[shard->touched].touched_prev = frame;
+		}
+		shard->touched = frame;
+	}
+}
+
+// NAME: forget_frame
+// PURPOSE: drop what was noted for a frame whose page leaves the pool and
+// take it off the touched list of its shard. The shard latch is held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - shard: shard of the page the frame holds
+// - frame: index of the frame
+// RETURN VAL: none
+static void forget_frame(Queue *q, Page_Shard *shard, int frame){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+
+	if(pf->touched){
+		if(pf->touched_prev != -1){
+			q->Page_Frame[pf->touched_prev].touched_next = pf->touched_next;
+		}
+		else{
+			shard->touched = pf->touched_next;
+		}
+		if(pf->touched_next != -1){
+			q->Page_Frame[pf->touched_next].touched_prev = pf->touched_prev;
+		}
+	}
+	pf->touched = 0;
+	pf->touched_prev = -1;
+	pf->touched_next = -1;
+	pf->new_hits = 0;
+	pf->ref_stamp = 0;
+}
+
+// NAME: pin_frame
+// PURPOSE: look up the frame holding a page and pin it. Pinning under the
+// shard latch keeps an eviction, which unmaps the page under the same latch,
+// from taking the frame away, and a resize, which holds every shard latch,
+// from moving it. A hit sets the CLOCK reference bit and is noted for the
+// other strategies, it never takes the pool latch.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - key: page to look up
+// - contents: receives the page buffer of the frame
+// - hit: a client pins the page, false when the pool holds it for a write
+// RETURN VAL: frame index, -1 if the page is not in the pool. The index is
+// only valid under the pool latch, which keeps resizes out.
+static int pin_frame(Queue *q, Page_Key key, SM_PageHandle *contents, bool hit){
+
+	Page_Shard *shard = shard_of(q, key);
+	int frame;
+
+	pthread_mutex_lock(&shard->latch);
+	frame = table_find(&shard->table, key);
+	if(frame != -1){
+		__atomic_add_fetch(&q->Page_Frame[frame].fix_count, 1, __ATOMIC_ACQ_REL);
+		if(hit){
+			__atomic_store_n(&q->Page_Frame[frame].ref_bit, 1, __ATOMIC_RELAXED);
+			note_frame(q, shard, frame, NOTE_HIT);
+		}
+		*contents = q->Page_Frame[frame].contents;
+	}
+	pthread_mutex_unlock(&shard->latch);
+	return frame;
+}
+
+// NAME: unpin_frame
+// PURPOSE: release a pin on a page. Releasing the last pin makes the frame a
+// candidate victim again, which is noted for the strategy.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - key: page to unpin
+// - event: NOTE_UNPIN for a pin of a client, NOTE_RELEASE for one the pool held
+// RETURN VAL: none
+static void unpin_frame(Queue *q, Page_Key key, int event){
+
+	Page_Shard *shard = shard_of(q, key);
+	int frame;
+
+	pthread_mutex_lock(&shard->latch);
+	frame = table_find(&shard->table, key);
+	if(frame != -1 && frame_pinned(q, frame)
+			&& __atomic_sub_fetch(&q->Page_Frame[frame].fix_count, 1, __ATOMIC_ACQ_REL) == 0){
+		note_frame(q, shard, frame, event);
+	}
+	pthread_mutex_unlock(&shard->latch);
+}
+
+// NAME: insert_frame
+// PURPOSE: add a frame to the page table under the page it holds
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// RETURN VAL: none
+static void insert_frame(Queue *q, int frame){
+
+	Page_Shard *shard = shard_of(q, frame_key(q, frame));
+
+	pthread_mutex_lock(&shard->latch);
+	table_insert(&shard->table, frame_key(q, frame), frame);
+	pthread_mutex_unlock(&shard->latch);
+}
+
+// NAME: free_queue
+// PURPOSE: release the bookkeeping of a buffer pool and its page frames
+// PARAMS: 
+// - q: queue of the buffer pool
+// RETURN VAL: none
+static void free_queue(Queue *q){
+
+	Arena_Extent *extent;
+
+	if(q->arena != NULL){
+		munmap(q->arena, q->arena_size);
+	}
+	while((extent = q->extents) != NULL){
+		q->extents = extent->next;
+		munmap(extent->base, extent->size);
+		free(extent);
+	}
+	free(q->free_pages);
+	free(q->retired_pages);
+	for(int i = 0; i < PAGE_TABLE_SHARDS; i++){
+		pthread_mutex_destroy(&q->shards[i].latch);
+		free(q->shards[i].table.slots);
+	}
+	for(int i = 0; i < q->max_entries; i++){
+		pthread_mutex_destroy(&q->frame_latches[i]);
+	}
+	pthread_mutex_destroy(&q->pool_latch);
+	pthread_rwlock_destroy(&q->file_latch);
+	pthread_mutex_destroy(&q->writer_latch);
+	pthread_cond_destroy(&q->writer_wake);
+	pthread_cond_destroy(&q->deferred_done);
+	free(q->frame_latches);
+	free(q->writer_order);
+	free(q->touched_frames);
+	free(q->deferred);
+	free(q->frame_times);
+	free(q->hit_times);
+	free(q->heap);
+	free(q->heap_pos);
+	free(q->retained_keys);
+	free(q->retained_times);
+	free(q->retained_table.slots);
+	free(q->ghosts);
+	free(q->ghost_table.slots);
+	free(q->Page_Frame);
+	free(q);
+}
+
+// NAME: create_pool
+// PURPOSE: initialize the frames, the replacement state and the page arena of
+// a pool that has no file attached yet
+// PARAMS: 
+// - pool: receives the new pool, NULL if it could not be created
+// - numPages: number of frames in the pool
 // - strategy - replacement strategy
-// - stratData - page handle to store read data into memory
-// RETURN VAL: RC_OK
-RC initBufferPool(BM_BufferPool *const bm, 
-					const char *const pageFileName, 
+// - stratData - for RS_LRU_K a pointer to K, NULL for the default of 2
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY
+static RC create_pool(Queue **pool, 
 					const int numPages, 
 					ReplacementStrategy strategy, 
 					void *stratData){
@@ -40,410 +765,3307 @@ RC initBufferPool(BM_BufferPool *const bm,
 
 	Queue *q = (Queue *) malloc(sizeof(Queue));
 
+	*pool = NULL;
+
 	q->Page_Frame = malloc(sizeof(Page_Frame)*(numPages));
 	q->max_entries = numPages;
+
+	// each shard starts with its share of the pool and grows if pages hash unevenly
+	for(int i = 0; i < PAGE_TABLE_SHARDS; i++){
+		pthread_mutex_init(&q->shards[i].latch, NULL);
+		table_init(&q->shards[i].table, shard_entries(numPages));
+		q->shards[i].touched = -1;
+	}
+	pthread_mutex_init(&q->pool_latch, NULL);
+	pthread_rwlock_init(&q->file_latch, NULL);
+	q->frame_latches = malloc(sizeof(pthread_mutex_t)*numPages);
+	for(int i = 0; i < numPages; i++){
+		pthread_mutex_init(&q->frame_latches[i], NULL);
+	}
+	memset(q->evict_stamps, 0, sizeof(q->evict_stamps));
+	q->ref_clock = 0;
+	q->touched_frames = malloc(sizeof(Touched_Frame)*numPages);
+	q->num_dirty = 0;
+	pthread_mutex_init(&q->writer_latch, NULL);
+	pthread_cond_init(&q->writer_wake, NULL);
+	pthread_cond_init(&q->deferred_done, NULL);
+	q->deferred = NULL;
+	q->num_deferred = 0;
+	q->deferred_size = 0;
+	q->writer_running = 0;
+	q->writer_stop = 0;
+	q->writer_threshold = 0;
+	q->writer_percent = 0;
+	q->writer_order = malloc(sizeof(int)*numPages);
 	q->head = 0;
 	q->tail = 0; 
 	q->num_entries = 0; 
 
 	for(int i = 0; i < numPages; i++){
 		q->Page_Frame[i].page_num = -1; 
+		q->Page_Frame[i].file_id = 0; 
 		q->Page_Frame[i].page_dirty = 0; 
 		q->Page_Frame[i].fix_count = 0; 
 		q->Page_Frame[i].num_hit = 0; 
 		q->num_files_written = 0;
 		q->num_files_read = 0;
 		q->Page_Frame[i].contents = NULL; 
+		q->Page_Frame[i].prev = -1; 
+		q->Page_Frame[i].next = -1; 
+		q->Page_Frame[i].ref_bit = 0; 
+		q->Page_Frame[i].arc_list = ARC_RECENT; 
+		q->Page_Frame[i].listed = 0; 
+		q->Page_Frame[i].touched = 0; 
+		q->Page_Frame[i].touched_prev = -1; 
+		q->Page_Frame[i].touched_next = -1; 
+		q->Page_Frame[i].new_hits = 0; 
+		q->Page_Frame[i].ref_stamp = 0; 
+	}
+	q->num_clean_evictions = 0;
+	q->num_dirty_evictions = 0;
+	q->lru.head = -1;
+	q->lru.tail = -1;
+	for(int i = 0; i <= LFU_MAX_COUNT; i++){
+		q->lfu_buckets[i].head = -1;
+		q->lfu_buckets[i].tail = -1;
+	}
+	q->lfu_min = LFU_MAX_COUNT + 1;
+	q->lfu_ticks = 0;
+	q->clock_hand = 0;
+
+	// LRU-K takes K from stratData and keeps the history of as many evicted
+	// pages as the pool has frames
+	q->frame_times = NULL;
+	q->hit_times = NULL;
+	q->heap = NULL;
+	q->heap_pos = NULL;
+	q->retained_keys = NULL;
+	q->retained_times = NULL;
+	q->retained_table.slots = NULL;
+	if(strategy == RS_LRU_K){
+		q->lru_k = (stratData != NULL && *(int *)stratData > 0) ? *(int *)stratData : LRU_K_DEFAULT;
+		q->frame_times = calloc((size_t)numPages * q->lru_k, sizeof(long));
+		q->hit_times = calloc((size_t)numPages * q->lru_k, sizeof(long));
+		q->heap = malloc(sizeof(int)*numPages);
+		q->heap_pos = malloc(sizeof(int)*numPages);
+		q->heap_size = 0;
+		q->retained_keys = malloc(sizeof(Page_Key)*numPages);
+		q->retained_times = malloc(sizeof(long)*numPages*q->lru_k);
+		q->retained_next = 0;
+		table_init(&q->retained_table, numPages);
+		for(int i = 0; i < numPages; i++){
+			q->heap_pos[i] = -1;
+			q->retained_keys[i] = NO_KEY;
+		}
 	}
 
-	bm->pageFile = (char *)pageFileName;
-	bm->numPages = numPages;
-	bm->strategy = strategy;
-	bm->mgmtData = q; 
+	q->arena = NULL;
+	q->free_pages = NULL;
+	q->extents = NULL;
+	q->retired_pages = NULL;
+	q->num_retired_pages = 0;
+
+	// ARC remembers as many evicted pages as the pool has frames
+	q->ghosts = NULL;
+	q->ghost_table.slots = NULL;
+	for(int i = ARC_RECENT; i <= ARC_FREQUENT; i++){
+		q->arc_lists[i].head = -1;
+		q->arc_lists[i].tail = -1;
+		q->arc_sizes[i] = 0;
+		q->ghost_lists[i].head = -1;
+		q->ghost_lists[i].tail = -1;
+		q->ghost_sizes[i] = 0;
+	}
+	q->arc_target = 0;
+	q->ghost_free = -1;
+	if(strategy == RS_ARC){
+		q->ghosts = malloc(sizeof(Ghost_Entry)*numPages);
+		table_init(&q->ghost_table, numPages);
+		for(int i = numPages - 1; i >= 0; i--){
+			q->ghosts[i].next = q->ghost_free;
+			q->ghost_free = i;
+		}
+	}
+
+	// one page aligned arena holds a buffer for every frame and the spare
+	// pages, so the footprint of the pool is fixed once it exists
+	q->arena_size = (size_t)(numPages + SPARE_PAGES) * PAGE_SIZE;
+	q->arena = mmap(NULL, q->arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	q->num_pages = numPages + SPARE_PAGES;
+	q->free_pages = malloc(sizeof(SM_PageHandle)*q->num_pages);
+	if(q->arena == MAP_FAILED || q->free_pages == NULL){
+		q->arena = q->arena == MAP_FAILED ? NULL : q->arena;
+		free_queue(q);
+		return RC_OUT_OF_MEMORY;
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(q->arena, q->arena_size, MADV_HUGEPAGE);
+#endif
+	for(int i = 0; i < numPages; i++){
+		q->Page_Frame[i].contents = q->arena + (size_t)i * PAGE_SIZE;
+	}
+	for(int i = 0; i < SPARE_PAGES; i++){
+		q->free_pages[i] = q->arena + (size_t)(numPages + i) * PAGE_SIZE;
+	}
+	q->num_free_pages = SPARE_PAGES;
+
+	q->files = NULL;
+	q->next_file_id = 0;
+	q->strategy = strategy;
+	q->shared = 0;
+
+	// the engines that write evicted pages back and read prefetched pages
+	// start on first use, pools that never need them cost no threads
+	q->write_queue.mgmtInfo = NULL;
+	q->num_pending = 0;
+	q->read_queue.mgmtInfo = NULL;
+	q->num_prefetches = 0;
 
+	*pool = q;
 	return RC_OK; 
 
 }
 
+// NAME: attach_file
+// PURPOSE: open a page file and cache its pages in a pool through a handle.
+// A file the pool already caches for another handle, the same device and
+// inode through the same backend, is shared with it instead of being opened
+// again, so both handles see the same pages. The file stays open until its
+// last handle is shut down, every read and write of its pages goes through
+// it. Attaches to a pool do not run concurrently, see openSharedBufferPool.
+// PARAMS: 
+// - q: queue of the pool
+// - bm: buffer pool handle to set up
+// - pageFileName: name of the page file
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY, RC_FILE_NOT_FOUND
+static RC attach_file(Queue *q, BM_BufferPool *const bm, const char *const pageFileName){
+
+	const SM_Backend *backend = getStorageBackend();
+	struct stat file_stat;
+	bool on_disk = stat(pageFileName, &file_stat) == 0;
+	Pool_File *file;
+
+	// a file that is being detached is not shared any more
+	pthread_mutex_lock(&q->pool_latch);
+	for(file = q->files; file != NULL; file = file->next){
+		if(on_disk && file->on_disk && file->num_handles > 0 && file->fh.backend == backend
+				&& file->dev == file_stat.st_dev && file->ino == file_stat.st_ino){
+			file->num_handles++;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&q->pool_latch);
+
+	if(file == NULL){
+		file = (Pool_File *) malloc(sizeof(Pool_File));
+		if(file == NULL){
+			return RC_OUT_OF_MEMORY;
+		}
+		if(openPageFile((char *)pageFileName, &file->fh) != RC_OK){
+			free(file);
+			return RC_FILE_NOT_FOUND;
+		}
+		file->pool = q;
+		file->on_disk = on_disk;
+		file->dev = on_disk ? file_stat.st_dev : 0;
+		file->ino = on_disk ? file_stat.st_ino : 0;
+		file->num_handles = 1;
+
+		pthread_mutex_lock(&q->pool_latch);
+		file->file_id = q->next_file_id++;
+		file->write_error = RC_OK;
+		file->next = q->files;
+		q->files = file;
+		pthread_mutex_unlock(&q->pool_latch);
+	}
+
+	bm->pageFile = (char *)pageFileName;
+	bm->numPages = q->max_entries;
+	bm->strategy = q->strategy;
+	bm->mgmtData = file; 
+
+	return RC_OK;
+}
+
+// NAME: initBufferPool
+// PURPOSE: initialize all elements of the buffer pool
+// PARAMS: 
+// - bm: buffer pool 
+// - pageFileName: name of the file we will be writing to
+// - numPages: number of pages in our buffer pool
+// - strategy - replacement strategy
+// - stratData - for RS_LRU_K a pointer to K, NULL for the default of 2
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY, RC_FILE_NOT_FOUND
+RC initBufferPool(BM_BufferPool *const bm, 
+					const char *const pageFileName, 
+					const int numPages, 
+					ReplacementStrategy strategy, 
+					void *stratData){
+
+	Queue *q;
+	RC rc_return;
+
+	if((rc_return = create_pool(&q, numPages, strategy, stratData)) != RC_OK){
+		return rc_return;
+	}
+
+	// a private pool caches exactly one file
+	if((rc_return = attach_file(q, bm, pageFileName)) != RC_OK){
+		shutdownAsyncQueue(&q->write_queue);
+		shutdownAsyncQueue(&q->read_queue);
+		free_queue(q);
+	}
+	return rc_return;
+}
+
+// NAME: release_page
+// PURPOSE: give a page buffer of the arena back to the free pages
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - contents: page buffer no frame or write-back holds any more
+// RETURN VAL: none
+static void release_page(Queue *q, SM_PageHandle contents){
+	q->free_pages[q->num_free_pages++] = contents;
+}
+
 // check if queue is empty
 bool queue_empty(Queue *q){
     return (q->num_entries == 0);
 }
 
-// remove page frame from pool
-bool dequeue(Queue *q, BM_BufferPool *const bm){
+// NAME: write_back_failed
+// PURPOSE: keep a page whose write-back failed from being lost silently. A
+// page still in the pool is marked dirty again and goes out with the next
+// flush. An evicted page only existed in the buffer that could not be
+// written, the next forceFlushPool of its file reports RC_WRITE_FAILED.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page that could not be written
+// RETURN VAL: none
+static void write_back_failed(Queue *q, Pool_File *file, PageNumber pageNum){
 
-    SM_FileHandle fh;
+	int frame = find_frame(q, page_key(file->file_id, pageNum));
 
-    if(queue_empty(q)){
-        return QUEUE_EMPTY; 
-    }
+	if(frame == -1){
+		file->write_error = RC_WRITE_FAILED;
+		return;
+	}
+	pthread_mutex_lock(&q->frame_latches[frame]);
+	set_dirty(q, frame, 1);
+	pthread_mutex_unlock(&q->frame_latches[frame]);
+}
+
+// NAME: write_back_later
+// PURPOSE: hand a page buffer the write-back engine could not take to the
+// deferred writes. The next thread that releases the pool latch writes it,
+// see write_deferred, so no page is written under the latch. A newer copy of
+// a page whose deferred write has not started replaces the older one.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file the page belongs to
+// - pageNum: page to write
+// - contents: page buffer of the arena, returned to the free pages once written
+// RETURN VAL: none
+static void write_back_later(Queue *q, Pool_File *file, PageNumber pageNum, SM_PageHandle contents){
+
+	Pending_Write *deferred;
+	int size;
+
+	for(int i = 0; i < q->num_deferred; i++){
+		if(!q->deferred[i].started && q->deferred[i].page_num == pageNum && q->deferred[i].file == file){
+			release_page(q, q->deferred[i].contents);
+			q->deferred[i].contents = contents;
+			return;
+		}
+	}
 
-	if(q->Page_Frame[q->head].page_num != -1 && q->Page_Frame[q->head].fix_count == 0){
+	if(q->num_deferred == q->deferred_size){
+		size = 2 * q->deferred_size + WRITER_BATCH;
+		deferred = realloc(q->deferred, sizeof(Pending_Write) * size);
 
-		openPageFile(bm->pageFile, &fh);
-		writeBlock(q->Page_Frame[q->head].page_num, &fh, q->Page_Frame[q->head].contents);
-		fclose(fh.mgmtInfo);
-		q->Page_Frame[q->head].page_dirty = 0; 
+		// out of memory, the page is written right away
+		if(deferred == NULL){
+			if(writeBlock(pageNum, &file->fh, contents) != RC_OK){
+				write_back_failed(q, file, pageNum);
+			}
+			release_page(q, contents);
+			return;
+		}
+		q->deferred = deferred;
+		q->deferred_size = size;
+	}
 
-		q->head = (q->head + 1) % q->max_entries; 
-		q->num_entries--;
+	q->deferred[q->num_deferred].file = file;
+	q->deferred[q->num_deferred].page_num = pageNum;
+	q->deferred[q->num_deferred].contents = contents;
+	q->deferred[q->num_deferred].started = 0;
+	q->num_deferred++;
+}
 
-		return true; 
+// NAME: reap_write_backs
+// PURPOSE: collect finished write-backs and release their page buffers. A
+// write-back that failed is retried as a deferred write, see
+// write_back_failed if that fails as well.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - minCompletions: number of write-backs to wait for
+// RETURN VAL: none
+static void reap_write_backs(Queue *q, int minCompletions){
+
+	SM_Completion completions[WRITE_BACK_DEPTH];
+	int num_done = reapCompletions(&q->write_queue, completions, WRITE_BACK_DEPTH, minCompletions);
+
+	for(int k = 0; k < num_done; k++){
+		for(int i = 0; i < q->num_pending; i++){
 
+			if(q->pending[i].contents != completions[k].userData){
+				continue;
+			}
+
+			if(completions[k].rc != RC_OK){
+				write_back_later(q, q->pending[i].file, q->pending[i].page_num, q->pending[i].contents);
+			}
+			else{
+				release_page(q, q->pending[i].contents);
+			}
+			q->pending[i] = q->pending[--q->num_pending];
+			break;
+		}
 	}
+}
 
-	else{
+// NAME: take_page
+// PURPOSE: take a free page buffer of the arena. Buffers are page aligned, so
+// page files opened in SM_MODE_DIRECT read and write them without a bounce
+// page. When every spare page is on its way to disk a write-back is waited for.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: page buffer, NULL if none is free
+static SM_PageHandle take_page(Queue *q){
 
-		q->tail = (q->tail + 1) % q->max_entries; 
-		q->head = (q->head + 1) % q->max_entries; 
+	if(q->num_free_pages == 0 && q->num_pending > 0){
+		reap_write_backs(q, 1);
+	}
+	if(q->num_free_pages == 0){
+		return NULL;
+	}
+	return q->free_pages[--q->num_free_pages];
+}
 
-		return false; 
+// NAME: engine_write_in_flight
+// PURPOSE: check whether the write-back engine has not finished a write of a page
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page to look for
+// RETURN VAL: true if the engine is writing the page
+static bool engine_write_in_flight(Queue *q, Pool_File *file, PageNumber pageNum){
+
+	for(int i = 0; i < q->num_pending; i++){
+		if(q->pending[i].page_num == pageNum && q->pending[i].file == file){
+			return true;
+		}
+	}
+	return false;
+}
+
+// NAME: deferred_write_in_flight
+// PURPOSE: check whether a deferred write of a page has not finished yet
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page to look for
+// - started: only look for a write some thread is performing right now
+// RETURN VAL: true if such a write was found
+static bool deferred_write_in_flight(Queue *q, Pool_File *file, PageNumber pageNum, bool started){
+
+	for(int i = 0; i < q->num_deferred; i++){
+		if(q->deferred[i].page_num == pageNum && q->deferred[i].file == file
+				&& (q->deferred[i].started || !started)){
+			return true;
+		}
 	}
+	return false;
+}
 
+// NAME: write_back_in_flight
+// PURPOSE: check whether a write-back of a page has not finished yet
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page to look for
+// RETURN VAL: true if the page is on its way to disk
+static bool write_back_in_flight(Queue *q, Pool_File *file, PageNumber pageNum){
+	return engine_write_in_flight(q, file, pageNum) || deferred_write_in_flight(q, file, pageNum, false);
 }
 
-// add page frame to pool
-bool enqueue(Queue *q, 
-				PageNumber pageNum, 
-				Page_Frame new_frame){
+// NAME: write_deferred
+// PURPOSE: perform up to WRITER_BATCH deferred writes nobody has started, with
+// the pool latch released. A page whose earlier write another thread is still
+// performing waits for it, so two writes of a page never overtake each other.
+// The pool latch is held when it is called and when it returns.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: number of pages written, 0 if no deferred write could start
+static int write_deferred(Queue *q){
+
+	Pending_Write batch[WRITER_BATCH];
+	SM_FileHandle fh[WRITER_BATCH];
+	RC rc[WRITER_BATCH];
+	int num_batch = 0;
+
+	for(int i = 0; i < q->num_deferred && num_batch < WRITER_BATCH; i++){
+		if(q->deferred[i].started || deferred_write_in_flight(q, q->deferred[i].file, q->deferred[i].page_num, true)){
+			continue;
+		}
+		q->deferred[i].started = 1;
+		batch[num_batch] = q->deferred[i];
 
-    q->Page_Frame[q->tail] = new_frame; 
-	q->Page_Frame[q->tail].fix_count++; 
-    q->num_entries++; 
-    q->tail = (q->tail+1) % q->max_entries;
+		// write through a copy of the handle, the write may move its position
+		fh[num_batch] = q->deferred[i].file->fh;
+		num_batch++;
+	}
+	if(num_batch == 0){
+		return 0;
+	}
 
-    return true; 
+	pthread_mutex_unlock(&q->pool_latch);
+	pthread_rwlock_rdlock(&q->file_latch);
+	for(int i = 0; i < num_batch; i++){
+		rc[i] = writeBlock(batch[i].page_num, &fh[i], batch[i].contents);
+	}
+	pthread_rwlock_unlock(&q->file_latch);
+	pthread_mutex_lock(&q->pool_latch);
+
+	for(int i = 0; i < num_batch; i++){
+		for(int k = 0; k < q->num_deferred; k++){
+			if(q->deferred[k].contents == batch[i].contents){
+				q->deferred[k] = q->deferred[--q->num_deferred];
+				break;
+			}
+		}
+		if(rc[i] != RC_OK){
+			write_back_failed(q, batch[i].file, batch[i].page_num);
+		}
+		release_page(q, batch[i].contents);
+	}
 
+	pthread_cond_broadcast(&q->deferred_done);
+	return num_batch;
 }
 
-// NAME: FIFO
-// PURPOSE: FIFO page replacement strategy for buffer pool
+// NAME: wait_for_engine_write
+// PURPOSE: block until the write-back engine has no write of 'pageNum' in
+// flight, so two writes of the page never overtake each other in the engine.
+// The pool latch stays held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page about to be written
+// RETURN VAL: none
+static void wait_for_engine_write(Queue *q, Pool_File *file, PageNumber pageNum){
+
+	while(engine_write_in_flight(q, file, pageNum)){
+		reap_write_backs(q, 1);
+	}
+}
+
+// NAME: wait_for_write_back
+// PURPOSE: block until no write-back of 'pageNum' is in flight, so the page
+// is never read back from disk before its evicted contents reached it and a
+// write of the page is never overtaken by an older one. Deferred writes are
+// performed or waited for, which releases the pool latch for a while.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page about to be read or written
+// RETURN VAL: none
+static void wait_for_write_back(Queue *q, Pool_File *file, PageNumber pageNum){
+
+	while(write_back_in_flight(q, file, pageNum)){
+		if(engine_write_in_flight(q, file, pageNum)){
+			reap_write_backs(q, 1);
+		}
+		else if(write_deferred(q) == 0){
+			pthread_cond_wait(&q->deferred_done, &q->pool_latch);
+		}
+	}
+}
+
+// NAME: drain_write_backs
+// PURPOSE: block until every write-back in flight has finished. Deferred
+// writes release the pool latch for a while, see wait_for_write_back.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: none
+static void drain_write_backs(Queue *q){
+
+	while(q->num_pending > 0 || q->num_deferred > 0){
+		if(q->num_pending > 0){
+			reap_write_backs(q, q->num_pending);
+		}
+		else if(write_deferred(q) == 0){
+			pthread_cond_wait(&q->deferred_done, &q->pool_latch);
+		}
+	}
+}
+
+// NAME: unlock_pool
+// PURPOSE: release the pool latch. Deferred writes of pages the engine could
+// not take are performed first, outside the latch.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: none
+static void unlock_pool(Queue *q){
+
+	while(q->num_deferred > 0){
+		if(write_deferred(q) == 0){
+			break;
+		}
+	}
+	pthread_mutex_unlock(&q->pool_latch);
+}
+
+// NAME: take_prefetch
+// PURPOSE: remove a finished prefetch from the reads in flight
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - completion: completion of the read
+// - read: receives the prefetch
+// RETURN VAL: none
+static void take_prefetch(Queue *q, SM_Completion *completion, Pending_Read *read){
+
+	for(int i = 0; i < q->num_prefetches; i++){
+		if(q->prefetches[i].contents == completion->userData){
+			*read = q->prefetches[i];
+			q->prefetches[i] = q->prefetches[q->num_prefetches - 1];
+			__atomic_sub_fetch(&q->num_prefetches, 1, __ATOMIC_RELEASE);
+			return;
+		}
+	}
+}
+
+// NAME: drop_prefetches
+// PURPOSE: block until every prefetch in flight has finished and drop the
+// pages it read, for when the file handles the reads use are about to change
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: none
+static void drop_prefetches(Queue *q){
+
+	SM_Completion completions[PREFETCH_DEPTH];
+	Pending_Read read;
+	int num_done;
+
+	while(q->num_prefetches > 0){
+		num_done = reapCompletions(&q->read_queue, completions, PREFETCH_DEPTH, q->num_prefetches);
+		for(int k = 0; k < num_done; k++){
+			take_prefetch(q, &completions[k], &read);
+			release_page(q, read.contents);
+		}
+	}
+}
+
+// NAME: prefetch_in_flight
+// PURPOSE: check whether a prefetch of a page has not been placed yet
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page to look for
+// RETURN VAL: true if the page is being prefetched
+static bool prefetch_in_flight(Queue *q, Pool_File *file, PageNumber pageNum){
+
+	for(int i = 0; i < q->num_prefetches; i++){
+		if(q->prefetches[i].page_num == pageNum && q->prefetches[i].file == file){
+			return true;
+		}
+	}
+	return false;
+}
+
+// NAME: ensure_pool_capacity
+// PURPOSE: grow a page file of the pool so it holds 'numberOfPages' pages.
+// Write-backs in flight are finished and prefetches dropped first, growing may
+// move a mapped file.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file to grow
+// - numberOfPages: number of pages the file must hold
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC ensure_pool_capacity(Queue *q, Pool_File *file, int numberOfPages){
+
+	RC rc_return;
+
+	if(numberOfPages <= file->fh.totalNumPages){
+		return RC_OK;
+	}
+	drain_write_backs(q);
+	drop_prefetches(q);
+
+	// no read outside the pool latch may use the file while it grows
+	pthread_rwlock_wrlock(&q->file_latch);
+	rc_return = ensureCapacity(numberOfPages, &file->fh);
+	pthread_rwlock_unlock(&q->file_latch);
+	return rc_return;
+}
+
+// NAME: start_async_queue
+// PURPOSE: start the engine of an asynchronous queue of the pool the first
+// time it is used. The pool latch is held.
+// PARAMS: 
+// - queue: write or read queue of the pool
+// - queueDepth: maximum number of requests in flight
+// RETURN VAL: true, false if the engine could not be started
+static bool start_async_queue(SM_AsyncQueue *queue, int queueDepth){
+
+	return queue->mgmtInfo != NULL || initAsyncQueue(queue, queueDepth) == RC_OK;
+}
+
+// NAME: write_back_async
+// PURPOSE: start writing a page buffer back to disk without waiting for it.
+// The buffer is handed to the write and becomes a free page when it
+// completes. Evictions hand over the frame's buffer, the frame receives
+// another one when it is filled again, the background writer hands over a copy.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file the page belongs to
+// - pageNum: page being written
+// - contents: page buffer of the arena holding the page
+// RETURN VAL: true, false if the write could not be started
+static bool write_back_async(Queue *q, Pool_File *file, PageNumber pageNum, SM_PageHandle contents){
+
+	if(!start_async_queue(&q->write_queue, WRITE_BACK_DEPTH)){
+		return false;
+	}
+
+	// make room in the write queue
+	if(q->num_pending == WRITE_BACK_DEPTH){
+		reap_write_backs(q, 1);
+	}
+
+	if(submitWriteBlock(&q->write_queue, pageNum, &file->fh, contents, contents) != RC_OK){
+		return false;
+	}
+
+	q->pending[q->num_pending].file = file;
+	q->pending[q->num_pending].page_num = pageNum;
+	q->pending[q->num_pending].contents = contents;
+	q->num_pending++;
+
+	return true;
+}
+
+// NAME: list_unlink
+// PURPOSE: take a frame out of a frame list
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - list: list holding the frame
+// - frame: index of a frame on the list
+// RETURN VAL: none
+static void list_unlink(Queue *q, Frame_List *list, int frame){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+
+	if(pf->prev != -1){
+		q->Page_Frame[pf->prev].next = pf->next;
+	}
+	else{
+		list->head = pf->next;
+	}
+	if(pf->next != -1){
+		q->Page_Frame[pf->next].prev = pf->prev;
+	}
+	else{
+		list->tail = pf->prev;
+	}
+	pf->prev = -1;
+	pf->next = -1;
+}
+
+// NAME: list_push_front
+// PURPOSE: put a frame at the front, the most recently used end, of a frame list
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - list: list to add to
+// - frame: index of a frame that is not on any list
+// RETURN VAL: none
+static void list_push_front(Queue *q, Frame_List *list, int frame){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+
+	pf->prev = -1;
+	pf->next = list->head;
+	if(list->head != -1){
+		q->Page_Frame[list->head].prev = frame;
+	}
+	else{
+		list->tail = frame;
+	}
+	list->head = frame;
+}
+
+// NAME: lfu_push
+// PURPOSE: put an unpinned frame into the LFU bucket of its reference count
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of a frame that is not in a bucket
+// RETURN VAL: none
+static void lfu_push(Queue *q, int frame){
+
+	int count = q->Page_Frame[frame].num_hit;
+
+	list_push_front(q, &q->lfu_buckets[count], frame);
+	if(count < q->lfu_min){
+		q->lfu_min = count;
+	}
+}
+
+// NAME: lfu_victim
+// PURPOSE: find the least recently used frame of the lowest non empty LFU
+// bucket. There are LFU_MAX_COUNT buckets at most, so this is constant time.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: index of the frame, -1 if every frame is pinned
+static int lfu_victim(Queue *q){
+
+	while(q->lfu_min <= LFU_MAX_COUNT){
+		if(q->lfu_buckets[q->lfu_min].tail != -1){
+			return q->lfu_buckets[q->lfu_min].tail;
+		}
+		q->lfu_min++;
+	}
+	return -1;
+}
+
+// NAME: lfu_age
+// PURPOSE: halve every LFU reference count, so pages that were hot once but
+// are no longer used drift down to the evictable buckets
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: none
+static void lfu_age(Queue *q){
+
+	int frame;
+
+	q->lfu_ticks = 0;
+
+	// pinned frames are not in a bucket
+	for(int i = 0; i < q->max_entries; i++){
+		if(q->Page_Frame[i].page_num != NO_PAGE && !q->Page_Frame[i].listed){
+			q->Page_Frame[i].num_hit = (q->Page_Frame[i].num_hit + 1) / 2;
+		}
+	}
+
+	// move every bucket down, oldest frame first so the order is kept. The
+	// target buckets are below the current one and already halved.
+	for(int count = 2; count <= LFU_MAX_COUNT; count++){
+		while((frame = q->lfu_buckets[count].tail) != -1){
+			list_unlink(q, &q->lfu_buckets[count], frame);
+			q->Page_Frame[frame].num_hit = (count + 1) / 2;
+			list_push_front(q, &q->lfu_buckets[(count + 1) / 2], frame);
+		}
+	}
+	q->lfu_min = (q->lfu_min + 1) / 2;
+}
+
+// NAME: lru_k_times
+// PURPOSE: locate the reference history of a frame
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// RETURN VAL: the frame's last K reference times, most recent first, 0 for
+// references that never happened
+static long *lru_k_times(Queue *q, int frame){
+	return &q->frame_times[(size_t)frame * q->lru_k];
+}
+
+// NAME: lru_k_reference
+// PURPOSE: record a reference to the page held by a frame
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// RETURN VAL: none
+static void lru_k_reference(Queue *q, int frame){
+
+	long *times = lru_k_times(q, frame);
+
+	memmove(times + 1, times, sizeof(long) * (q->lru_k - 1));
+	times[0] = next_stamp(q);
+}
+
+// NAME: lru_k_before
+// PURPOSE: LRU-K victim order. The frame whose K-th most recent reference is
+// oldest goes first, frames with fewer than K references count as infinitely
+// old and among those the least recently used goes first.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - a, b: frames to compare
+// RETURN VAL: 1 if 'a' should be evicted before 'b', 0 otherwise
+static int lru_k_before(Queue *q, int a, int b){
+
+	long *times_a = lru_k_times(q, a);
+	long *times_b = lru_k_times(q, b);
+
+	if(times_a[q->lru_k - 1] != times_b[q->lru_k - 1]){
+		return times_a[q->lru_k - 1] < times_b[q->lru_k - 1];
+	}
+	return times_a[0] < times_b[0];
+}
+
+// NAME: heap_place
+// PURPOSE: store a frame at a position of the LRU-K victim heap
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - pos: heap position
+// - frame: index of the frame
+// RETURN VAL: none
+static void heap_place(Queue *q, int pos, int frame){
+	q->heap[pos] = frame;
+	q->heap_pos[frame] = pos;
+}
+
+// NAME: heap_sift
+// PURPOSE: restore the heap order around a position whose frame changed,
+// moving it up towards the root or down towards the leaves
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - pos: heap position to fix
+// RETURN VAL: none
+static void heap_sift(Queue *q, int pos){
+
+	int frame = q->heap[pos];
+	int child;
+
+	// move up while the frame goes before its parent
+	while(pos > 0 && lru_k_before(q, frame, q->heap[(pos - 1) / 2])){
+		heap_place(q, pos, q->heap[(pos - 1) / 2]);
+		pos = (pos - 1) / 2;
+	}
+
+	// move down while a child goes before the frame
+	while((child = 2 * pos + 1) < q->heap_size){
+		if(child + 1 < q->heap_size && lru_k_before(q, q->heap[child + 1], q->heap[child])){
+			child++;
+		}
+		if(!lru_k_before(q, q->heap[child], frame)){
+			break;
+		}
+		heap_place(q, pos, q->heap[child]);
+		pos = child;
+	}
+	heap_place(q, pos, frame);
+}
+
+// NAME: heap_push
+// PURPOSE: make an unpinned frame a candidate victim
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of a frame that is not in the heap
+// RETURN VAL: none
+static void heap_push(Queue *q, int frame){
+	heap_place(q, q->heap_size++, frame);
+	heap_sift(q, q->heap_size - 1);
+}
+
+// NAME: heap_remove
+// PURPOSE: take a frame out of the LRU-K victim heap
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of a frame in the heap
+// RETURN VAL: none
+static void heap_remove(Queue *q, int frame){
+
+	int pos = q->heap_pos[frame];
+
+	q->heap_pos[frame] = -1;
+	if(--q->heap_size == pos){
+		return;
+	}
+
+	// fill the hole with the last frame and put that one in order
+	heap_place(q, pos, q->heap[q->heap_size]);
+	heap_sift(q, pos);
+}
+
+// NAME: lru_k_fold
+// PURPOSE: add the hits noted for a frame to its reference history. The
+// frame leaves the victim heap first, its place there depends on the history.
+// The first hit of a prefetched page only moves the reference the prefetch
+// recorded to the time of the hit. The shard latch of the frame is held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// - hits: number of hits noted, at least 1
+// RETURN VAL: none
+static void lru_k_fold(Queue *q, int frame, int hits){
+
+	long *times = lru_k_times(q, frame);
+	int num_new = hits < q->lru_k ? hits : q->lru_k;
+	int skip = q->Page_Frame[frame].prefetched ? 1 : 0;
+
+	if(q->heap_pos[frame] != -1){
+		heap_remove(q, frame);
+	}
+	memmove(times + num_new, times + skip, sizeof(long) * (q->lru_k - num_new));
+	memcpy(times, &q->hit_times[(size_t)frame * q->lru_k], sizeof(long) * num_new);
+}
+
+// NAME: lru_k_retain
+// PURPOSE: keep the history of a page that is about to be evicted, so a page
+// that comes back soon is not treated like a new one. The oldest retained
+// history is dropped to make room.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the victim frame
+// - key: page the victim held
+// RETURN VAL: none
+static void lru_k_retain(Queue *q, int frame, Page_Key key){
+
+	int slot = q->retained_next;
+
+	q->retained_next = (slot + 1) % q->max_entries;
+	if(q->retained_keys[slot] != NO_KEY){
+		table_remove(&q->retained_table, q->retained_keys[slot]);
+	}
+
+	q->retained_keys[slot] = key;
+	memcpy(&q->retained_times[(size_t)slot * q->lru_k], lru_k_times(q, frame), sizeof(long) * q->lru_k);
+	table_insert(&q->retained_table, q->retained_keys[slot], slot);
+}
+
+// NAME: lru_k_restore
+// PURPOSE: give a frame that was just filled the retained history of its page,
+// or an empty history for a page that was not seen recently
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// RETURN VAL: none
+static void lru_k_restore(Queue *q, int frame){
+
+	Page_Key key = frame_key(q, frame);
+	int slot = table_find(&q->retained_table, key);
+
+	if(slot == -1){
+		memset(lru_k_times(q, frame), 0, sizeof(long) * q->lru_k);
+		return;
+	}
+
+	memcpy(lru_k_times(q, frame), &q->retained_times[(size_t)slot * q->lru_k], sizeof(long) * q->lru_k);
+	table_remove(&q->retained_table, key);
+	q->retained_keys[slot] = NO_KEY;
+}
+
+// NAME: ghost_unlink
+// PURPOSE: take an entry out of an ARC ghost list
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - entry: index of a ghost entry on one of the ghost lists
+// RETURN VAL: none
+static void ghost_unlink(Queue *q, int entry){
+
+	Ghost_Entry *ghost = &q->ghosts[entry];
+	Frame_List *list = &q->ghost_lists[ghost->list];
+
+	if(ghost->prev != -1){
+		q->ghosts[ghost->prev].next = ghost->next;
+	}
+	else{
+		list->head = ghost->next;
+	}
+	if(ghost->next != -1){
+		q->ghosts[ghost->next].prev = ghost->prev;
+	}
+	else{
+		list->tail = ghost->prev;
+	}
+	q->ghost_sizes[ghost->list]--;
+}
+
+// NAME: ghost_forget
+// PURPOSE: drop a page from the ARC ghost lists and recycle its entry
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - entry: index of a ghost entry on one of the ghost lists
+// RETURN VAL: none
+static void ghost_forget(Queue *q, int entry){
+
+	ghost_unlink(q, entry);
+	table_remove(&q->ghost_table, q->ghosts[entry].key);
+	q->ghosts[entry].next = q->ghost_free;
+	q->ghost_free = entry;
+}
+
+// NAME: ghost_add
+// PURPOSE: remember a page evicted from an ARC list at the front of the
+// matching ghost list. If every entry is used the oldest ghost of that list,
+// or of the other one when it is empty, is dropped.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - list: ghost list to add to, ARC_RECENT or ARC_FREQUENT
+// - key: page that was evicted
+// RETURN VAL: none
+static void ghost_add(Queue *q, int list, Page_Key key){
+
+	int entry;
+
+	if(q->ghost_free == -1){
+		if(q->ghost_lists[list].tail != -1){
+			ghost_forget(q, q->ghost_lists[list].tail);
+		}
+		else{
+			ghost_forget(q, q->ghost_lists[1 - list].tail);
+		}
+	}
+
+	entry = q->ghost_free;
+	q->ghost_free = q->ghosts[entry].next;
+
+	q->ghosts[entry].key = key;
+	q->ghosts[entry].list = list;
+	q->ghosts[entry].prev = -1;
+	q->ghosts[entry].next = q->ghost_lists[list].head;
+	if(q->ghost_lists[list].head != -1){
+		q->ghosts[q->ghost_lists[list].head].prev = entry;
+	}
+	else{
+		q->ghost_lists[list].tail = entry;
+	}
+	q->ghost_lists[list].head = entry;
+	q->ghost_sizes[list]++;
+	table_insert(&q->ghost_table, key, entry);
+}
+
+// NAME: arc_lru_unpinned
+// PURPOSE: find the least recently used unpinned frame of an ARC list. Pinned
+// frames stay on the lists and are skipped, there are rarely more than a few.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - list: ARC_RECENT or ARC_FREQUENT
+// RETURN VAL: index of the frame, -1 if every frame of the list is pinned
+static int arc_lru_unpinned(Queue *q, int list){
+
+	int frame = q->arc_lists[list].tail;
+
+	while(frame != -1 && frame_pinned(q, frame)){
+		frame = q->Page_Frame[frame].prev;
+	}
+	return frame;
+}
+
+// NAME: arc_replace
+// PURPOSE: ARC's choice between the two resident lists. The recent list gives
+// up a frame while it is larger than the target, the frequent list otherwise.
+// If the chosen list only holds pinned frames the other one is used.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - target: target size of the recent list
+// - from_frequent_ghost: the requested page was found in the frequent ghost list
+// RETURN VAL: index of the victim frame, -1 if every frame is pinned
+static int arc_replace(Queue *q, int target, bool from_frequent_ghost){
+
+	int recent = arc_lru_unpinned(q, ARC_RECENT);
+	int frequent = arc_lru_unpinned(q, ARC_FREQUENT);
+
+	if(recent != -1 && (frequent == -1 || q->arc_sizes[ARC_RECENT] > target
+			|| (from_frequent_ghost && q->arc_sizes[ARC_RECENT] == target))){
+		return recent;
+	}
+	return frequent;
+}
+
+// NAME: evict_frame
+// PURPOSE: write an unpinned frame back if it was modified and free it for
+// another page. A clean frame matches the page on disk and is just dropped.
+// A hit may have pinned the frame since it was picked, then it is left alone.
+// What was noted for the frame and not folded yet goes with the page.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the victim frame
+// RETURN VAL: true, false if the frame is pinned
+static bool evict_frame(Queue *q, int frame){
+
+	Page_Frame *victim = &q->Page_Frame[frame];
+	Page_Key key = frame_key(q, frame);
+	Page_Shard *shard = shard_of(q, key);
+	Pool_File *file;
+	bool dirty;
+
+	// hits pin under the shard latch, once the page is unmapped nobody can
+	pthread_mutex_lock(&shard->latch);
+	if(frame_pinned(q, frame)){
+		pthread_mutex_unlock(&shard->latch);
+		return false;
+	}
+	table_remove(&shard->table, key);
+	forget_frame(q, shard, frame);
+	pthread_mutex_unlock(&shard->latch);
+
+	pthread_mutex_lock(&q->frame_latches[frame]);
+	dirty = victim->page_dirty;
+	set_dirty(q, frame, 0);
+	pthread_mutex_unlock(&q->frame_latches[frame]);
+
+	// reads that raced this eviction are repeated
+	(*evict_stamp(q, key))++;
+
+	// write a dirty victim back in the background, or once the pool latch is
+	// released. A copy written earlier has to land first, a page with a
+	// deferred write queues behind it. Files are flushed before they detach,
+	// so a dirty page's file is attached.
+	if(dirty){
+		file = pool_file(q, victim->file_id);
+		wait_for_engine_write(q, file, victim->page_num);
+		if(deferred_write_in_flight(q, file, victim->page_num, false)
+				|| !write_back_async(q, file, victim->page_num, victim->contents)){
+			write_back_later(q, file, victim->page_num, victim->contents);
+		}
+		victim->contents = NULL;
+		q->num_files_written++;
+		q->num_dirty_evictions++;
+	}
+	else{
+		q->num_clean_evictions++;
+	}
+
+	// the frame is free now
+	victim->page_num = NO_PAGE;
+	q->num_entries--;
+	return true;
+}
+
+// NAME: install_frame
+// PURPOSE: place a page that was just read into a free frame and pin it. The
+// buffer the frame held before becomes a free page.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the free frame
+// - new_frame: page to place
+// RETURN VAL: none
+static void install_frame(Queue *q, int frame, Page_Frame new_frame){
+
+	if(q->Page_Frame[frame].contents != NULL){
+		release_page(q, q->Page_Frame[frame].contents);
+	}
+
+	new_frame.fix_count = 1;
+	new_frame.prev = -1;
+	new_frame.next = -1;
+	new_frame.listed = 0;
+	new_frame.prefetched = 0;
+	new_frame.touched = 0;
+	new_frame.touched_prev = -1;
+	new_frame.touched_next = -1;
+	new_frame.new_hits = 0;
+	new_frame.ref_stamp = 0;
+	q->Page_Frame[frame] = new_frame;
+	insert_frame(q, frame);
+	q->num_entries++;
+}
+
+// remove page frame from pool
+bool dequeue(Queue *q){
+
+    if(queue_empty(q)){
+        return QUEUE_EMPTY; 
+    }
+
+	if(q->Page_Frame[q->head].page_num != -1 && evict_frame(q, q->head)){
+
+		q->head = (q->head + 1) % q->max_entries; 
+
+		return true; 
+
+	}
+
+	else{
+
+		q->tail = (q->tail + 1) % q->max_entries; 
+		q->head = (q->head + 1) % q->max_entries; 
+
+		return false; 
+	}
+
+}
+
+// add page frame to pool
+bool enqueue(Queue *q, Page_Frame new_frame){
+
+    install_frame(q, q->tail, new_frame);
+    q->tail = (q->tail+1) % q->max_entries;
+
+    return true; 
+
+}
+
+// NAME: make_room
+// PURPOSE: dequeue frames until the oldest unpinned one has been evicted
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: true, false if every frame is pinned
+static bool make_room(Queue *q){
+
+	int dequeue_attempts = 0; 
+
+	while (dequeue(q) != true){
+
+		// if we have gone through the whole buffer without a successful dequeue, give up
+		if(dequeue_attempts > q->max_entries){
+			return false;
+		}
+		dequeue_attempts++; 
+	}
+
+	return true;
+}
+
+// NAME: read_frame
+// PURPOSE: read a page that is not in the pool into a new, unpinned frame.
+// This is the only place pinPage touches the disk, hits never get here. The
+// read itself holds no latch, so misses do not stall each other or the hits.
+// Every eviction bumps the stamp of its page, and if the page was evicted
+// while it was being read its newer contents may have reached the disk since.
+// In that case the page is read again, once its write-back has landed.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - file: file of the page
+// - pageNum: page to read
+// - new_frame: frame receiving the page
+// RETURN VAL: true, false if the page could not be read. The pool latch is
+// held when it returns either way.
+static bool read_frame(Queue *q, Pool_File *file, PageNumber pageNum, Page_Frame *new_frame){
+
+	Page_Key key = page_key(file->file_id, pageNum);
+	SM_FileHandle fh;
+	unsigned int stamp;
+	bool read_ok;
+
+	// initialize new page data
+	new_frame->page_num = pageNum;
+	new_frame->file_id = file->file_id;
+	new_frame->fix_count = 0; 
+	new_frame->page_dirty = 0;
+	new_frame->num_hit = 0;
+	new_frame->ref_bit = 0;
+
+	pthread_mutex_lock(&q->pool_latch);
+
+	// buffers of evicted pages waiting for a deferred write free up once it is done
+	while((new_frame->contents = take_page(q)) == NULL){
+		if(q->num_deferred == 0){
+			return false;
+		}
+		if(write_deferred(q) == 0){
+			pthread_cond_wait(&q->deferred_done, &q->pool_latch);
+		}
+	}
+
+	//ensure file has enough capacity for the frame
+	if(ensure_pool_capacity(q, file, pageNum + 1) != RC_OK){
+		release_page(q, new_frame->contents);
+		return false;
+	}
+
+	do{
+
+		// an evicted copy of the page may still be on its way to disk
+		wait_for_write_back(q, file, pageNum);
+
+		// read through a copy of the handle, the read moves its position
+		fh = file->fh;
+		stamp = *evict_stamp(q, key);
+		pthread_mutex_unlock(&q->pool_latch);
+
+		pthread_rwlock_rdlock(&q->file_latch);
+		read_ok = readBlock(pageNum, &fh, new_frame->contents) == RC_OK;
+		pthread_rwlock_unlock(&q->file_latch);
+
+		pthread_mutex_lock(&q->pool_latch);
+
+	} while(read_ok && stamp != *evict_stamp(q, key));
+
+	if(!read_ok){
+		release_page(q, new_frame->contents);
+		return false;
+	}
+
+	return true;
+}
+
+// NAME: sync_frame
+// PURPOSE: bring the place of a frame in the replacement state in line with
+// its fix count, after the pool dropped a pin it took itself. Pins and unpins
+// of clients are caught up with by fold_references instead.
+// PARAMS: 
+// - bm: active buffer pool
+// - q: queue of the active buffer pool
+// - frame: index of a frame holding a page
+// RETURN VAL: none
+static void sync_frame(BM_BufferPool *const bm, Queue *q, int frame){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+	bool pinned = frame_pinned(q, frame);
+
+	// a pinned frame is no candidate victim, an unpinned one is the most recent
+	if(bm->strategy == RS_LRU && pinned && pf->listed){
+		list_unlink(q, &q->lru, frame);
+		pf->listed = 0;
+	}
+	else if(bm->strategy == RS_LRU && !pinned && !pf->listed){
+		list_push_front(q, &q->lru, frame);
+		pf->listed = 1;
+	}
+
+	// or goes back into the bucket of its reference count
+	else if(bm->strategy == RS_LFU && pinned && pf->listed){
+		list_unlink(q, &q->lfu_buckets[pf->num_hit], frame);
+		pf->listed = 0;
+	}
+	else if(bm->strategy == RS_LFU && !pinned && !pf->listed){
+		lfu_push(q, frame);
+		pf->listed = 1;
+	}
+
+	// or into the heap of candidate victims
+	else if(bm->strategy == RS_LRU_K && pinned && q->heap_pos[frame] != -1){
+		heap_remove(q, frame);
+	}
+	else if(bm->strategy == RS_LRU_K && !pinned && q->heap_pos[frame] == -1){
+		heap_push(q, frame);
+	}
+}
+
+// NAME: fold_frame
+// PURPOSE: replay what happened to a touched frame since the last fold, see
+// fold_references
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// - hits: number of hits noted for it
+// - stamped: a client released its last pin (LRU, LFU) or hit it (ARC)
+// RETURN VAL: none
+static void fold_frame(Queue *q, int frame, int hits, bool stamped){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+	bool pinned = frame_pinned(q, frame);
+
+	// the first pin of a prefetched page is its first reference, it only
+	// moves the reference the prefetch recorded to now
+	if(pf->prefetched && hits > 0){
+		pf->prefetched = 0;
+		hits--;
+	}
+
+	// a pinned frame is no candidate victim, an unpinned one a client released
+	// is the most recent. One the pool released keeps its place.
+	if(q->strategy == RS_LRU){
+		if(pf->listed && (pinned || stamped)){
+			list_unlink(q, &q->lru, frame);
+			pf->listed = 0;
+		}
+		if(!pinned && !pf->listed){
+			list_push_front(q, &q->lru, frame);
+			pf->listed = 1;
+		}
+		pf->num_hit += hits;
+	}
+
+	// or goes back into the bucket of its reference count. The counts age
+	// every LFU_AGING_PERIOD pins per frame, at the hit that was due.
+	else if(q->strategy == RS_LFU){
+		if(pf->listed && (pinned || stamped || hits > 0)){
+			list_unlink(q, &q->lfu_buckets[pf->num_hit], frame);
+			pf->listed = 0;
+		}
+		for(int i = 0; i < hits; i++){
+			if(++q->lfu_ticks >= q->max_entries * LFU_AGING_PERIOD){
+				lfu_age(q);
+			}
+			if(pf->num_hit < LFU_MAX_COUNT){
+				pf->num_hit++;
+			}
+		}
+		if(!pinned && !pf->listed){
+			lfu_push(q, frame);
+			pf->listed = 1;
+		}
+	}
+
+	// or into the heap of candidate victims, the history was extended already
+	else if(q->strategy == RS_LRU_K){
+		if(pinned && q->heap_pos[frame] != -1){
+			heap_remove(q, frame);
+		}
+		else if(!pinned && q->heap_pos[frame] == -1){
+			heap_push(q, frame);
+		}
+		pf->num_hit += hits;
+	}
+
+	// a page referenced again while resident becomes frequent
+	else if(q->strategy == RS_ARC && hits > 0){
+		list_unlink(q, &q->arc_lists[pf->arc_list], frame);
+		q->arc_sizes[pf->arc_list]--;
+		pf->arc_list = ARC_FREQUENT;
+		list_push_front(q, &q->arc_lists[ARC_FREQUENT], frame);
+		q->arc_sizes[ARC_FREQUENT]++;
+		pf->num_hit += hits;
+	}
+}
+
+// NAME: compare_touched
+// PURPOSE: qsort comparator that orders touched frames by their stamps
+// PARAMS: 
+// - a, b: pointers to the touched frames being compared
+// RETURN VAL: <0, 0, >0
+static int compare_touched(const void *a, const void *b){
+
+	long left = ((const Touched_Frame *)a)->stamp;
+	long right = ((const Touched_Frame *)b)->stamp;
+
+	return (left > right) - (left < right);
+}
+
+// NAME: fold_references
+// PURPOSE: bring the replacement state up to date with the hits and unpins
+// noted since the last fold, before the strategy picks a victim. The touched
+// frames are taken off every shard and replayed in the order of their
+// stamps, so the state ends up as if every hit and unpin had updated it
+// right away. Hits and unpins never wait for the pool latch this way.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - latched: the caller holds every shard latch, as a resize does
+// RETURN VAL: none
+static void fold_references(Queue *q, bool latched){
+
+	Touched_Frame *touched = q->touched_frames;
+	Page_Shard *shard;
+	Page_Frame *pf;
+	int num_touched = 0;
+	int frame;
+
+	if(q->strategy == RS_FIFO || q->strategy == RS_CLOCK){
+		return;
+	}
+
+	for(int i = 0; i < PAGE_TABLE_SHARDS; i++){
+
+		shard = &q->shards[i];
+		if(!latched){
+			pthread_mutex_lock(&shard->latch);
+		}
+		while((frame = shard->touched) != -1){
+			pf = &q->Page_Frame[frame];
+			touched[num_touched].stamp = pf->ref_stamp;
+			touched[num_touched].frame = frame;
+			touched[num_touched].hits = pf->new_hits;
+			num_touched++;
+
+			// the hit times live with the shard latch
+			if(q->strategy == RS_LRU_K && pf->new_hits > 0){
+				lru_k_fold(q, frame, pf->new_hits);
+			}
+			shard->touched = pf->touched_next;
+			forget_frame(q, shard, frame);
+		}
+		if(!latched){
+			pthread_mutex_unlock(&shard->latch);
+		}
+	}
+
+	qsort(touched, num_touched, sizeof(Touched_Frame), compare_touched);
+	for(int i = 0; i < num_touched; i++){
+		fold_frame(q, touched[i].frame, touched[i].hits, touched[i].stamp != 0);
+	}
+}
+
+// NAME: FIFO
+// PURPOSE: FIFO page replacement strategy for buffer pool. Places a page that
+// missed, the pool latch is held.
+// PARAMS: 
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+bool FIFO(BM_BufferPool * const bm, Page_Frame new_frame){
+
+	// Get the queue handle
+	Queue *q = pool_of(bm);
+
+	// evict the oldest unpinned frame when there is no empty slot left
+	if(q->num_entries == q->max_entries && !make_room(q)){
+		return false;
+	}
+
+	enqueue(q, new_frame);
+
+	// increment files read
+	q->num_files_read++;
+
+	return true; 
+}
+
+// NAME: LRU
+// PURPOSE: LRU page replacement strategy for buffer pool. Unpinned frames sit
+// on a recency list, a pin takes the frame off the list and releasing its last
+// pin puts it back at the most recent end. The least recently used unpinned
+// frame is therefore always at the tail and evicted in constant time. Places
+// a page that missed, the pool latch is held.
+// PARAMS: 
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+bool LRU(BM_BufferPool * const bm, Page_Frame new_frame){
+
+	// Get the queue handle
+	Queue *q = pool_of(bm);
+
+	int frame;
+
+	// frames are filled in order, after that the least recent one is replaced.
+	// A frame pinned since it was listed just leaves the list.
+	if(q->num_entries < q->max_entries){
+		frame = q->num_entries;
+	}
+	else{
+		while((frame = q->lru.tail) != -1){
+			list_unlink(q, &q->lru, frame);
+			q->Page_Frame[frame].listed = 0;
+			if(evict_frame(q, frame)){
+				break;
+			}
+		}
+
+		// every frame is pinned
+		if(frame == -1){
+			return false;
+		}
+	}
+
+	install_frame(q, frame, new_frame);
+
+	q->num_files_read++;
+
+	return true; 
+}
+
+// NAME: CLOCK
+// PURPOSE: CLOCK (second chance) page replacement strategy for buffer pool. A
+// hit only sets the frame's reference bit. On a miss the hand sweeps the
+// frames, clearing reference bits, and evicts the first unpinned frame whose
+// bit is already clear. Places a page that missed, the pool latch is held.
+// PARAMS: 
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+bool CLOCK(BM_BufferPool * const bm, Page_Frame new_frame){
+
+	// Get the queue handle
+	Queue *q = pool_of(bm);
+
+	int frame = -1;
+
+	// frame under the hand
+	Page_Frame *pf;
+
+	// frames are filled in order, after that the hand picks the victim
+	if(q->num_entries < q->max_entries){
+		frame = q->num_entries;
+	}
+	else{
+
+		// two full turns clear every reference bit, after that only pinned
+		// frames can be left
+		for(int step = 0; frame == -1 && step < 2 * q->max_entries; step++){
+
+			pf = &q->Page_Frame[q->clock_hand];
+			if(!frame_pinned(q, q->clock_hand) && __atomic_load_n(&pf->ref_bit, __ATOMIC_RELAXED) == 0
+					&& evict_frame(q, q->clock_hand)){
+				frame = q->clock_hand;
+			}
+			else if(!frame_pinned(q, q->clock_hand)){
+				__atomic_store_n(&pf->ref_bit, 0, __ATOMIC_RELAXED);
+			}
+			q->clock_hand = (q->clock_hand + 1) % q->max_entries;
+		}
+
+		// every frame is pinned
+		if(frame == -1){
+			return false;
+		}
+	}
+
+	new_frame.ref_bit = 1;
+	install_frame(q, frame, new_frame);
+
+	q->num_files_read++;
+
+	return true; 
+}
+
+// NAME: LFU
+// PURPOSE: LFU page replacement strategy for buffer pool. Unpinned frames sit
+// in buckets by reference count, the victim is the least recently used frame
+// of the lowest bucket. Counts saturate at LFU_MAX_COUNT and are halved
+// periodically so the pool follows a changing hot set. Places a page that
+// missed, the pool latch is held.
+// PARAMS: 
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+bool LFU(BM_BufferPool * const bm, Page_Frame new_frame){
+
+	// Get the queue handle
+	Queue *q = pool_of(bm);
+
+	int frame;
+
+	// age the counts every LFU_AGING_PERIOD pins per frame
+	if(++q->lfu_ticks >= q->max_entries * LFU_AGING_PERIOD){
+		lfu_age(q);
+	}
+
+	// frames are filled in order, after that the least used one is replaced.
+	// A frame pinned since it was bucketed just leaves its bucket.
+	if(q->num_entries < q->max_entries){
+		frame = q->num_entries;
+	}
+	else{
+		while((frame = lfu_victim(q)) != -1){
+			list_unlink(q, &q->lfu_buckets[q->Page_Frame[frame].num_hit], frame);
+			q->Page_Frame[frame].listed = 0;
+			if(evict_frame(q, frame)){
+				break;
+			}
+		}
+
+		// every frame is pinned
+		if(frame == -1){
+			return false;
+		}
+	}
+
+	install_frame(q, frame, new_frame);
+	q->Page_Frame[frame].num_hit = 1;
+
+	q->num_files_read++;
+
+	return true; 
+}
+
+// NAME: LRU_K
+// PURPOSE: LRU-K page replacement strategy for buffer pool. The victim is the
+// unpinned frame whose K-th most recent reference is the oldest, so pages
+// touched once by a scan are evicted before pages with repeated references.
+// Unpinned frames are kept in a heap ordered that way, and the history of
+// recently evicted pages is kept so they keep their references when they
+// come back. Places a page that missed, the pool latch is held.
+// PARAMS: 
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+bool LRU_K(BM_BufferPool * const bm, Page_Frame new_frame){
+
+	// Get the queue handle
+	Queue *q = pool_of(bm);
+
+	int frame = -1;
+	Page_Key victim_key;
+
+	// frames are filled in order, after that the top of the heap is replaced.
+	// A frame pinned since it was pushed just leaves the heap.
+	if(q->num_entries < q->max_entries){
+		frame = q->num_entries;
+	}
+	else{
+		while(frame == -1 && q->heap_size > 0){
+			frame = q->heap[0];
+			victim_key = frame_key(q, frame);
+			heap_remove(q, frame);
+			if(evict_frame(q, frame)){
+				lru_k_retain(q, frame, victim_key);
+			}
+			else{
+				frame = -1;
+			}
+		}
+
+		// every frame is pinned
+		if(frame == -1){
+			return false;
+		}
+	}
+
+	install_frame(q, frame, new_frame);
+	lru_k_restore(q, frame);
+	lru_k_reference(q, frame);
+
+	q->num_files_read++;
+
+	return true; 
+}
+
+// NAME: ARC
+// PURPOSE: adaptive replacement cache strategy for buffer pool. Resident pages
+// are split between a recent list (referenced once) and a frequent list
+// (referenced again while resident), and evicted pages are remembered in two
+// ghost lists. A miss that hits a ghost list moves the target size of the
+// recent list towards the list that would have kept the page, so the pool
+// tunes itself between recency and frequency, and a scan only ever churns the
+// recent list. Places a page that missed, the pool latch is held.
+// PARAMS: 
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+bool ARC(BM_BufferPool * const bm, Page_Frame new_frame){
+
+	// Get the queue handle
+	Queue *q = pool_of(bm);
+
+	int capacity = q->max_entries;
+	int target = q->arc_target;
+	int frame, ghost, ghost_list = -1, delta;
+	int victim_list;
+	Page_Key victim_key;
+	bool keep_ghost = true;
+
+	// a ghost hit means the list that evicted the page was too small
+	ghost = table_find(&q->ghost_table, page_key(new_frame.file_id, new_frame.page_num));
+	if(ghost != -1){
+		ghost_list = q->ghosts[ghost].list;
+		if(ghost_list == ARC_RECENT){
+			delta = q->ghost_sizes[ARC_FREQUENT] / q->ghost_sizes[ARC_RECENT];
+			target += delta > 1 ? delta : 1;
+			target = target < capacity ? target : capacity;
+		}
+		else{
+			delta = q->ghost_sizes[ARC_RECENT] / q->ghost_sizes[ARC_FREQUENT];
+			target -= delta > 1 ? delta : 1;
+			target = target > 0 ? target : 0;
+		}
+	}
+
+	// frames are filled in order, after that ARC picks the victim
+	if(q->num_entries < capacity){
+		frame = q->num_entries;
+	}
+	else{
+
+		// once the recent list alone fills the history its oldest page is
+		// dropped without leaving a ghost. A frame pinned since it was picked
+		// is skipped by the next pick.
+		do{
+			frame = -1;
+			if(ghost == -1 && q->ghost_sizes[ARC_RECENT] == 0
+					&& q->arc_sizes[ARC_RECENT] >= capacity){
+				frame = arc_lru_unpinned(q, ARC_RECENT);
+				keep_ghost = false;
+			}
+			if(frame == -1){
+				frame = arc_replace(q, target, ghost_list == ARC_FREQUENT);
+				keep_ghost = true;
+			}
+
+			// every frame is pinned
+			if(frame == -1){
+				return false;
+			}
+
+			victim_key = frame_key(q, frame);
+			victim_list = q->Page_Frame[frame].arc_list;
+		} while(!evict_frame(q, frame));
+
+		// keep the history within twice the pool size
+		if(ghost != -1){
+			ghost_forget(q, ghost);
+		}
+		else if(q->arc_sizes[ARC_RECENT] + q->ghost_sizes[ARC_RECENT] >= capacity){
+			if(q->ghost_sizes[ARC_RECENT] > 0){
+				ghost_forget(q, q->ghost_lists[ARC_RECENT].tail);
+			}
+		}
+		else if(q->num_entries + 1 + q->ghost_sizes[ARC_RECENT] + q->ghost_sizes[ARC_FREQUENT] >= 2 * capacity
+				&& q->ghost_sizes[ARC_FREQUENT] > 0){
+			ghost_forget(q, q->ghost_lists[ARC_FREQUENT].tail);
+		}
+
+		list_unlink(q, &q->arc_lists[victim_list], frame);
+		q->arc_sizes[victim_list]--;
+		if(keep_ghost){
+			ghost_add(q, victim_list, victim_key);
+		}
+
+	}
+	q->arc_target = target;
+
+	// pages coming back from a ghost list were referenced twice already
+	install_frame(q, frame, new_frame);
+	q->Page_Frame[frame].arc_list = ghost != -1 ? ARC_FREQUENT : ARC_RECENT;
+	list_push_front(q, &q->arc_lists[q->Page_Frame[frame].arc_list], frame);
+	q->arc_sizes[q->Page_Frame[frame].arc_list]++;
+
+	q->num_files_read++;
+
+	return true; 
+}
+
+// NAME: victim_order
+// PURPOSE: list the frames roughly in the order the strategy evicts them, so
+// the background writer cleans the next victims first. FIFO and CLOCK go round
+// from the frame they evict next, LRU walks its list from the least recent
+// end, LFU its buckets from the least frequent one and ARC first the list it
+// currently shrinks. LRU-K takes its heap in array order, which starts with
+// the next victim. The pool latch is held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - order: receives up to one index per frame
+// RETURN VAL: number of frames in 'order'
+static int victim_order(Queue *q, int *order){
+
+	int num_frames = 0;
+	int first;
+
+	fold_references(q, false);
+	if(q->strategy == RS_LRU){
+		for(int frame = q->lru.tail; frame != -1; frame = q->Page_Frame[frame].prev){
+			order[num_frames++] = frame;
+		}
+	}
+	else if(q->strategy == RS_LFU){
+		for(int count = 0; count <= LFU_MAX_COUNT; count++){
+			for(int frame = q->lfu_buckets[count].tail; frame != -1; frame = q->Page_Frame[frame].prev){
+				order[num_frames++] = frame;
+			}
+		}
+	}
+	else if(q->strategy == RS_LRU_K){
+		for(int i = 0; i < q->heap_size; i++){
+			order[num_frames++] = q->heap[i];
+		}
+	}
+	else if(q->strategy == RS_ARC){
+		first = q->arc_sizes[ARC_RECENT] > q->arc_target ? ARC_RECENT : ARC_FREQUENT;
+		for(int list = first, k = 0; k < 2; k++, list = ARC_FREQUENT - list){
+			for(int frame = q->arc_lists[list].tail; frame != -1; frame = q->Page_Frame[frame].prev){
+				order[num_frames++] = frame;
+			}
+		}
+	}
+	else{
+		first = q->strategy == RS_CLOCK ? q->clock_hand : q->head;
+		for(int i = 0; i < q->max_entries; i++){
+			order[num_frames++] = (first + i) % q->max_entries;
+		}
+	}
+	return num_frames;
+}
+
+// NAME: trickle_dirty_frames
+// PURPOSE: write one batch of dirty, unpinned frames back so misses find clean
+// victims. A page is copied into a spare buffer under its shard latch, so no
+// client can pin and modify it half way, and the copy goes out through the
+// write-back engine. The frame stays in the pool, clean. Frames are taken in
+// victim_order, and spare buffers and write-back slots misses need are left
+// alone.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - low_water: the batch ends once no more frames than this are dirty
+// RETURN VAL: number of pages written
+static int trickle_dirty_frames(Queue *q, int low_water){
+
+	Page_Shard *shard;
+	Pool_File *file;
+	SM_PageHandle copy;
+	PageNumber pageNum;
+	int num_written = 0;
+	int num_frames, frame;
+
+	pthread_mutex_lock(&q->pool_latch);
+
+	// collect the copies earlier batches wrote
+	reap_write_backs(q, 0);
+
+	num_frames = victim_order(q, q->writer_order);
+
+	for(int i = 0; i < num_frames && num_written < WRITER_BATCH; i++){
+
+		if(__atomic_load_n(&q->num_dirty, __ATOMIC_RELAXED) <= low_water ||
+				q->num_pending >= WRITE_BACK_DEPTH / 2 || q->num_free_pages <= READ_AHEAD_RUN){
+			break;
+		}
+
+		// pages of detached files are clean, and an older copy still in
+		// flight could land after a new one
+		frame = q->writer_order[i];
+		pageNum = q->Page_Frame[frame].page_num;
+		if(pageNum == NO_PAGE || (file = pool_file(q, q->Page_Frame[frame].file_id)) == NULL
+				|| write_back_in_flight(q, file, pageNum)){
+			continue;
+		}
+
+		copy = NULL;
+		shard = shard_of(q, frame_key(q, frame));
+		pthread_mutex_lock(&shard->latch);
+		pthread_mutex_lock(&q->frame_latches[frame]);
+		if(!frame_pinned(q, frame) && q->Page_Frame[frame].page_dirty != 0){
+			copy = take_page(q);
+			set_dirty(q, frame, 0);
+			memcpy(copy, q->Page_Frame[frame].contents, PAGE_SIZE);
+		}
+		pthread_mutex_unlock(&q->frame_latches[frame]);
+		pthread_mutex_unlock(&shard->latch);
+
+		if(copy == NULL){
+			continue;
+		}
+
+		// without the engine the copy is written once the pool latch is released
+		if(!write_back_async(q, file, pageNum, copy)){
+			write_back_later(q, file, pageNum, copy);
+		}
+		q->num_files_written++;
+		num_written++;
+	}
+
+	unlock_pool(q);
+	return num_written;
+}
+
+// NAME: writer_sleep
+// PURPOSE: let the background writer wait for a wake-up from markDirty, or
+// WRITER_PERIOD_MS at most. The caller holds the writer latch.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// RETURN VAL: none
+static void writer_sleep(Queue *q){
+
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += WRITER_PERIOD_MS * 1000000L;
+	if(deadline.tv_nsec >= 1000000000L){
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	pthread_cond_timedwait(&q->writer_wake, &q->writer_latch, &deadline);
+}
+
+// NAME: background_writer
+// PURPOSE: body of the background writer thread. Once the pool holds
+// writer_threshold dirty frames it trickles them to disk a batch at a time,
+// until half of that is left, so misses get the pool latch between batches.
+// PARAMS: 
+// - arg: queue of the pool
+// RETURN VAL: NULL
+static void *background_writer(void *arg){
+
+	Queue *q = (Queue *)arg;
+	bool trickling = false;
+	int num_dirty, threshold;
+
+	pthread_mutex_lock(&q->writer_latch);
+
+	while(!q->writer_stop){
+
+		num_dirty = __atomic_load_n(&q->num_dirty, __ATOMIC_RELAXED);
+		threshold = __atomic_load_n(&q->writer_threshold, __ATOMIC_RELAXED);
+		trickling = num_dirty >= threshold || (trickling && num_dirty > threshold / 2);
+
+		if(!trickling){
+			writer_sleep(q);
+			continue;
+		}
+
+		pthread_mutex_unlock(&q->writer_latch);
+		num_dirty = trickle_dirty_frames(q, threshold / 2);
+		pthread_mutex_lock(&q->writer_latch);
+
+		// every dirty frame is pinned or still on its way, try again later
+		if(num_dirty == 0){
+			writer_sleep(q);
+		}
+	}
+
+	pthread_mutex_unlock(&q->writer_latch);
+	return NULL;
+}
+
+// NAME: stop_writer
+// PURPOSE: stop the background writer of a pool if it runs, copies it started
+// keep going to disk
+// PARAMS: 
+// - q: queue of the pool
+// RETURN VAL: none
+static void stop_writer(Queue *q){
+
+	pthread_mutex_lock(&q->writer_latch);
+	if(!q->writer_running){
+		pthread_mutex_unlock(&q->writer_latch);
+		return;
+	}
+	q->writer_running = 0;
+	q->writer_stop = 1;
+	__atomic_store_n(&q->writer_threshold, 0, __ATOMIC_RELAXED);
+	pthread_cond_signal(&q->writer_wake);
+	pthread_mutex_unlock(&q->writer_latch);
+
+	pthread_join(q->writer_thread, NULL);
+}
+
+// NAME: set_writer_threshold
+// PURPOSE: turn the share of dirty frames the background writer was started
+// with into a number of frames, for the current size of the pool. The caller
+// holds the writer latch.
+// PARAMS: 
+// - q: queue of the pool
+// RETURN VAL: none
+static void set_writer_threshold(Queue *q){
+
+	int threshold = __atomic_load_n(&q->max_entries, __ATOMIC_RELAXED) * q->writer_percent / 100;
+
+	__atomic_store_n(&q->writer_threshold, threshold < 1 ? 1 : threshold, __ATOMIC_RELAXED);
+}
+
+// NAME: startBackgroundWriter
+// PURPOSE: start a thread that writes dirty frames back in the background
+// whenever more than 'dirtyPercent' percent of the frames are dirty, so a
+// miss rarely has to write its victim and forceFlushPool has little left to
+// do. Calling it again on a running writer only changes the threshold. The
+// writer belongs to the pool, for a shared pool any handle starts it and it
+// runs until shutdownSharedBufferPool.
 // PARAMS: 
 // - bm: active buffer pool
-// - page: page we will be writing to disk
-// - pageNum: page number
-// RETURN VAL: true, false
-bool FIFO(BM_BufferPool * const bm, BM_PageHandle * const page,
-		PageNumber pageNum){
+// - dirtyPercent: share of dirty frames, 1 to 100, that starts a write-back
+// RETURN VAL: RC_OK, RC_ASYNC_INIT_FAILED
+RC startBackgroundWriter (BM_BufferPool *const bm, const int dirtyPercent){
 
-	// Get the queue handle
-	Queue *q = (Queue *)bm->mgmtData;
+	Queue *q = pool_of(bm);
+	RC rc_return = RC_OK;
+
+	pthread_mutex_lock(&q->writer_latch);
+
+	q->writer_percent = dirtyPercent < 1 ? 1 : (dirtyPercent > 100 ? 100 : dirtyPercent);
+	set_writer_threshold(q);
+
+	if(!q->writer_running){
+		q->writer_stop = 0;
+		if(pthread_create(&q->writer_thread, NULL, background_writer, q) != 0){
+			__atomic_store_n(&q->writer_threshold, 0, __ATOMIC_RELAXED);
+			rc_return = RC_ASYNC_INIT_FAILED;
+		}
+		else{
+			q->writer_running = 1;
+		}
+	}
+
+	pthread_mutex_unlock(&q->writer_latch);
+	return rc_return;
+}
+
+// NAME: stopBackgroundWriter
+// PURPOSE: stop the background writer of the handle's pool
+// PARAMS: 
+// - bm: active buffer pool
+// RETURN VAL: RC_OK
+RC stopBackgroundWriter (BM_BufferPool *const bm){
+
+	stop_writer(pool_of(bm));
+	return RC_OK;
+}
+
+// NAME: detach_file
+// PURPOSE: detach a handle from its file, whose pages were flushed. The last
+// handle closes the file. Its pages stay in the pool, clean and under a file
+// id nobody looks up any more, until the strategy evicts them.
+// PARAMS: 
+// - q: queue of the pool
+// - file: file to detach
+// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND if it is the last handle and a page of
+// the file is still pinned, the handle stays attached then
+static RC detach_file(Queue *q, Pool_File *file){
+
+	Pool_File **link = &q->files;
+
+	pthread_mutex_lock(&q->pool_latch);
+
+	// other handles keep the file open
+	if(file->num_handles > 1){
+		file->num_handles--;
+		pthread_mutex_unlock(&q->pool_latch);
+		return RC_OK;
+	}
+
+	for(int i = 0; i < q->max_entries; i++)
+	{
+		// If fixCount != 0, it means that the contents of the page was modified by some client and has not been written back to disk.
+		if(q->Page_Frame[i].file_id == file->file_id && frame_pinned(q, i))
+		{
+			// return error code
+			pthread_mutex_unlock(&q->pool_latch);
+			return RC_PAGE_NOT_FOUND;
+		}
+	}
+	file->num_handles = 0;
+
+	// write-backs and prefetches still in flight may use the file handle
+	drain_write_backs(q);
+	drop_prefetches(q);
+
+	while(*link != file){
+		link = &(*link)->next;
+	}
+	*link = file->next;
+
+	pthread_mutex_unlock(&q->pool_latch);
+
+	closePageFile(&file->fh);
+	free(file);
+	return RC_OK;
+}
+
+// NAME: destroy_pool
+// PURPOSE: stop the threads of a pool that has no file attached any more and
+// release it
+// PARAMS: 
+// - q: queue of the pool
+// RETURN VAL: none
+static void destroy_pool(Queue *q){
+
+	stop_writer(q);
+	shutdownAsyncQueue(&q->write_queue);
+	shutdownAsyncQueue(&q->read_queue);
+	free_queue(q);
+}
+
+// NAME: shutdownBufferPool
+// PURPOSE: frees up all memory associated with the buffer pool. A handle of a
+// shared pool only flushes its own file and closes it if no other handle has
+// it open, the pool stays.
+// PARAMS: 
+// - bm: buffer pool to shut down
+// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_WRITE_FAILED
+RC shutdownBufferPool(BM_BufferPool *const bm){
+
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+
+	// the background writer must not touch a private pool while it goes away
+	if(!q->shared){
+		stop_writer(q);
+	}
+
+	// write all dirty pages back to disk, pages that could not be written keep
+	// the file attached
+	if(forceFlushPool(bm) != RC_OK){
+		return RC_WRITE_FAILED;
+	}
+
+	// close the page file, unless pages are still pinned or another handle
+	// of a shared pool uses it
+	if(detach_file(q, file) != RC_OK){
+		return RC_PAGE_NOT_FOUND;
+	}
+
+	// stop the write-back engine, release space occupied by the pages and the
+	// pool's bookkeeping
+	if(!q->shared){
+		destroy_pool(q);
+	}
+	bm->mgmtData = NULL;
+	return RC_OK; 
+
+}
+
+// NAME: initSharedBufferPool
+// PURPOSE: create the process wide pool every handle opened with
+// openSharedBufferPool caches its pages in. Pages of all those files compete
+// for the same frames, so memory goes to whichever files are hot.
+// PARAMS: 
+// - memoryBudget: bytes of page frames, the pool gets one frame per PAGE_SIZE
+// - strategy - replacement strategy
+// - stratData - for RS_LRU_K a pointer to K, NULL for the default of 2
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY, RC_BUFFER_POOL_IN_USE
+RC initSharedBufferPool(const size_t memoryBudget, ReplacementStrategy strategy, 
+		void *stratData){
+
+	int numPages = (int)(memoryBudget / PAGE_SIZE);
+	RC rc_return;
+
+	if(numPages < 1){
+		return RC_OUT_OF_MEMORY;
+	}
+
+	pthread_mutex_lock(&shared_pool_latch);
+
+	if(shared_pool != NULL){
+		pthread_mutex_unlock(&shared_pool_latch);
+		return RC_BUFFER_POOL_IN_USE;
+	}
+	if((rc_return = create_pool(&shared_pool, numPages, strategy, stratData)) == RC_OK){
+		shared_pool->shared = 1;
+	}
+
+	pthread_mutex_unlock(&shared_pool_latch);
+	return rc_return;
+}
+
+// NAME: openSharedBufferPool
+// PURPOSE: open a page file and cache its pages in the shared pool. The handle
+// works like one of a private pool, shutdownBufferPool flushes and closes it.
+// Handles that open the same file share its pages. The shared pool latch
+// keeps attaches from running concurrently.
+// PARAMS: 
+// - bm: buffer pool handle to set up
+// - pageFileName: name of the page file
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY, RC_FILE_NOT_FOUND, RC_BUFFER_POOL_NOT_INIT
+RC openSharedBufferPool(BM_BufferPool *const bm, const char *const pageFileName){
+
+	RC rc_return = RC_BUFFER_POOL_NOT_INIT;
+
+	pthread_mutex_lock(&shared_pool_latch);
+	if(shared_pool != NULL){
+		rc_return = attach_file(shared_pool, bm, pageFileName);
+	}
+	pthread_mutex_unlock(&shared_pool_latch);
+
+	return rc_return;
+}
+
+// NAME: shutdownSharedBufferPool
+// PURPOSE: release the shared pool once every handle was shut down
+// PARAMS: 
+// - NONE
+// RETURN VAL: RC_OK, RC_BUFFER_POOL_NOT_INIT, RC_BUFFER_POOL_IN_USE
+RC shutdownSharedBufferPool(void){
+
+	bool in_use;
+
+	pthread_mutex_lock(&shared_pool_latch);
+
+	if(shared_pool == NULL){
+		pthread_mutex_unlock(&shared_pool_latch);
+		return RC_BUFFER_POOL_NOT_INIT;
+	}
+
+	pthread_mutex_lock(&shared_pool->pool_latch);
+	in_use = shared_pool->files != NULL;
+	pthread_mutex_unlock(&shared_pool->pool_latch);
+
+	if(in_use){
+		pthread_mutex_unlock(&shared_pool_latch);
+		return RC_BUFFER_POOL_IN_USE;
+	}
+
+	destroy_pool(shared_pool);
+	shared_pool = NULL;
+
+	pthread_mutex_unlock(&shared_pool_latch);
+	return RC_OK;
+}
+
+// NAME: drop_frame
+// PURPOSE: evict an unpinned frame outside of a miss and take it out of the
+// replacement state the way the strategy does when it evicts on a miss
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - frame: index of the frame
+// - remember: keep the LRU-K history or ARC ghost of the page
+// RETURN VAL: true, false if the frame is empty or pinned
+static bool drop_frame(Queue *q, int frame, bool remember){
+
+	Page_Frame *pf = &q->Page_Frame[frame];
+	Page_Key key = frame_key(q, frame);
+	int list = pf->arc_list;
+
+	if(pf->page_num == NO_PAGE || !evict_frame(q, frame)){
+		return false;
+	}
+
+	if(q->strategy == RS_LRU && pf->listed){
+		list_unlink(q, &q->lru, frame);
+	}
+	else if(q->strategy == RS_LFU && pf->listed){
+		list_unlink(q, &q->lfu_buckets[pf->num_hit], frame);
+	}
+	else if(q->strategy == RS_LRU_K){
+		if(q->heap_pos[frame] != -1){
+			heap_remove(q, frame);
+		}
+		if(remember){
+			lru_k_retain(q, frame, key);
+		}
+	}
+	else if(q->strategy == RS_ARC){
+		list_unlink(q, &q->arc_lists[list], frame);
+		q->arc_sizes[list]--;
+		if(remember){
+			ghost_add(q, list, key);
+		}
+	}
+	pf->listed = 0;
+	return true;
+}
+
+// NAME: shed_frames
+// PURPOSE: evict pages until no more than 'numPages' frames are in use. The
+// next victims of the strategy go first, then frames it does not list yet,
+// such as ones whose last pin was just released.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - numPages: number of frames that may stay in use
+// RETURN VAL: true, false if too many frames are pinned
+static bool shed_frames(Queue *q, int numPages){
+
+	int num_frames = victim_order(q, q->writer_order);
+
+	for(int i = 0; i < num_frames && q->num_entries > numPages; i++){
+		drop_frame(q, q->writer_order[i], true);
+	}
+	for(int i = 0; i < q->max_entries && q->num_entries > numPages; i++){
+		drop_frame(q, i, true);
+	}
+	return q->num_entries <= numPages;
+}
+
+// NAME: add_pages
+// PURPOSE: give the pool 'count' more free page buffers. Buffers an earlier
+// shrink retired come back first, the rest are mapped as a new extent.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - count: number of buffers to add, nothing happens below 1
+// RETURN VAL: true, false when out of memory
+static bool add_pages(Queue *q, int count){
+
+	SM_PageHandle *free_pages;
+	Arena_Extent *extent;
+	int num_mapped;
+
+	if(count < 1){
+		return true;
+	}
+
+	// free_pages holds every buffer of the pool
+	free_pages = realloc(q->free_pages, sizeof(SM_PageHandle)*(q->num_pages + count));
+	if(free_pages == NULL){
+		return false;
+	}
+	q->free_pages = free_pages;
+
+	for(; count > 0 && q->num_retired_pages > 0; count--){
+		release_page(q, q->retired_pages[--q->num_retired_pages]);
+		q->num_pages++;
+	}
+	if(count == 0){
+		return true;
+	}
+
+	extent = malloc(sizeof(Arena_Extent));
+	if(extent == NULL){
+		return false;
+	}
+	extent->size = (size_t)count * PAGE_SIZE;
+	extent->base = mmap(NULL, extent->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(extent->base == MAP_FAILED){
+		free(extent);
+		return false;
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(extent->base, extent->size, MADV_HUGEPAGE);
+#endif
+	extent->next = q->extents;
+	q->extents = extent;
+
+	for(num_mapped = 0; num_mapped < count; num_mapped++){
+		release_page(q, extent->base + (size_t)num_mapped * PAGE_SIZE);
+	}
+	q->num_pages += count;
+	return true;
+}
+
+// NAME: retire_pages
+// PURPOSE: hand free page buffers back to the system until the pool owns no
+// more than 'numPages'. Their addresses stay reserved for add_pages. Buffers
+// a read holds right now are not free, the pool may keep a few more.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - numPages: number of buffers the pool should own
+// RETURN VAL: none
+static void retire_pages(Queue *q, int numPages){
+
+	SM_PageHandle *retired;
+	SM_PageHandle page;
+
+	if(q->num_pages <= numPages || q->num_free_pages == 0){
+		return;
+	}
+	retired = realloc(q->retired_pages, sizeof(SM_PageHandle)*(q->num_retired_pages + q->num_pages - numPages));
+	if(retired == NULL){
+		return;
+	}
+	q->retired_pages = retired;
+
+	while(q->num_pages > numPages && q->num_free_pages > 0){
+		page = q->free_pages[--q->num_free_pages];
+		madvise(page, PAGE_SIZE, MADV_DONTNEED);
+		q->retired_pages[q->num_retired_pages++] = page;
+		q->num_pages--;
+	}
+}
+
+// NAME: remap_list
+// PURPOSE: renumber the ends of a frame list after frames moved
+// PARAMS: 
+// - list: frame list
+// - new_index: new index of every old frame, -1 for frames that are gone
+// RETURN VAL: none
+static void remap_list(Frame_List *list, int *new_index){
+	list->head = list->head == -1 ? -1 : new_index[list->head];
+	list->tail = list->tail == -1 ? -1 : new_index[list->tail];
+}
+
+// NAME: resize_frames
+// PURPOSE: move the frames in use to the front of a frame array of the new
+// size and carry the per frame state along. FIFO and CLOCK frames are laid
+// out from the frame that goes next, so the queue and the hand start over at
+// frame 0. Buffers of empty frames become free pages. The pool latch and
+// every shard latch are held, no write-back is in flight and at most
+// 'numPages' frames are in use.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - numPages: new number of frames
+// RETURN VAL: none
+static void resize_frames(Queue *q, int numPages){
+
+	int old_entries = q->max_entries;
+	int start = q->strategy == RS_FIFO ? q->head : (q->strategy == RS_CLOCK ? q->clock_hand : 0);
+	int *new_index = malloc(sizeof(int)*old_entries);
+	Page_Frame *frames = malloc(sizeof(Page_Frame)*numPages);
+	int *old_heap = q->heap;
+	int old_heap_size = q->heap_size;
+	long *old_times = q->frame_times;
+	int num_frames = 0;
+	int frame;
+
+	for(int i = 0; i < old_entries; i++){
+		frame = (start + i) % old_entries;
+		new_index[frame] = -1;
+		if(q->Page_Frame[frame].page_num == NO_PAGE){
+			if(q->Page_Frame[frame].contents != NULL){
+				release_page(q, q->Page_Frame[frame].contents);
+			}
+			continue;
+		}
+		new_index[frame] = num_frames;
+		frames[num_frames++] = q->Page_Frame[frame];
+	}
+	for(int i = num_frames; i < numPages; i++){
+		frames[i].page_num = NO_PAGE;
+		frames[i].file_id = 0;
+		frames[i].page_dirty = 0;
+		frames[i].fix_count = 0;
+		frames[i].num_hit = 0;
+		frames[i].contents = NULL;
+		frames[i].prev = -1;
+		frames[i].next = -1;
+		frames[i].ref_bit = 0;
+		frames[i].arc_list = ARC_RECENT;
+		frames[i].listed = 0;
+		frames[i].touched = 0;
+		frames[i].touched_prev = -1;
+		frames[i].touched_next = -1;
+		frames[i].new_hits = 0;
+		frames[i].ref_stamp = 0;
+	}
+
+	// LRU list, LFU buckets and ARC lists
+	for(int i = 0; i < num_frames; i++){
+		frames[i].prev = frames[i].prev == -1 ? -1 : new_index[frames[i].prev];
+		frames[i].next = frames[i].next == -1 ? -1 : new_index[frames[i].next];
+	}
+	remap_list(&q->lru, new_index);
+	for(int i = 0; i <= LFU_MAX_COUNT; i++){
+		remap_list(&q->lfu_buckets[i], new_index);
+	}
+	remap_list(&q->arc_lists[ARC_RECENT], new_index);
+	remap_list(&q->arc_lists[ARC_FREQUENT], new_index);
+
+	// every frame has its own latch, none of them is held
+	for(int i = 0; i < old_entries; i++){
+		pthread_mutex_destroy(&q->frame_latches[i]);
+	}
+	free(q->frame_latches);
+	q->frame_latches = malloc(sizeof(pthread_mutex_t)*numPages);
+	for(int i = 0; i < numPages; i++){
+		pthread_mutex_init(&q->frame_latches[i], NULL);
+	}
+
+	free(q->Page_Frame);
+	q->Page_Frame = frames;
+	q->max_entries = numPages;
+	q->num_entries = num_frames;
+	q->head = 0;
+	q->tail = num_frames % numPages;
+	q->clock_hand = 0;
+	free(q->writer_order);
+	q->writer_order = malloc(sizeof(int)*numPages);
+	free(q->touched_frames);
+	q->touched_frames = malloc(sizeof(Touched_Frame)*numPages);
+
+	// the page table shards point at the new frame indexes
+	for(int i = 0; i < PAGE_TABLE_SHARDS; i++){
+		free(q->shards[i].table.slots);
+		table_init(&q->shards[i].table, shard_entries(numPages));
+	}
+	for(int i = 0; i < num_frames; i++){
+		table_insert(&shard_of(q, frame_key(q, i))->table, frame_key(q, i), i);
+	}
+
+	// LRU-K histories move with their frames, the heap is built again
+	if(q->strategy == RS_LRU_K){
+		q->frame_times = calloc((size_t)numPages * q->lru_k, sizeof(long));
+		for(int i = 0; i < old_entries; i++){
+			if(new_index[i] != -1){
+				memcpy(lru_k_times(q, new_index[i]), &old_times[(size_t)i * q->lru_k], sizeof(long) * q->lru_k);
+			}
+		}
+		free(q->heap_pos);
+		q->heap = malloc(sizeof(int)*numPages);
+		q->heap_pos = malloc(sizeof(int)*numPages);
+		q->heap_size = 0;
+		for(int i = 0; i < numPages; i++){
+			q->heap_pos[i] = -1;
+		}
+		for(int i = 0; i < old_heap_size; i++){
+			heap_push(q, new_index[old_heap[i]]);
+		}
+		free(old_heap);
+		free(old_times);
+
+		// nothing was noted since fold_references ran
+		free(q->hit_times);
+		q->hit_times = calloc((size_t)numPages * q->lru_k, sizeof(long));
+	}
+
+	free(new_index);
+}
+
+// NAME: resize_history
+// PURPOSE: fit the history of evicted pages LRU-K and ARC keep to the new
+// size of the pool, which they remember as many pages of as it has frames.
+// The most recent history is kept. The pool latch is held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - numPages: new number of frames
+// RETURN VAL: none
+static void resize_history(Queue *q, int numPages){
+
+	Page_Key *keys[2];
+	long *times;
+	int num_keys[2];
+	int num_retained = 0;
+	int skip, slot, kept, list;
+
+	if(q->strategy == RS_LRU_K){
+
+		// the ring holds the oldest history at retained_next
+		for(int i = 0; i < q->max_entries; i++){
+			num_retained += q->retained_keys[i] != NO_KEY;
+		}
+		skip = num_retained > numPages ? num_retained - numPages : 0;
+		keys[0] = malloc(sizeof(Page_Key)*numPages);
+		times = malloc(sizeof(long)*numPages*q->lru_k);
+		kept = 0;
+		for(int i = 0; i < q->max_entries; i++){
+			slot = (q->retained_next + i) % q->max_entries;
+			if(q->retained_keys[slot] == NO_KEY || skip-- > 0){
+				continue;
+			}
+			keys[0][kept] = q->retained_keys[slot];
+			memcpy(&times[(size_t)kept * q->lru_k], &q->retained_times[(size_t)slot * q->lru_k], sizeof(long) * q->lru_k);
+			kept++;
+		}
+
+		free(q->retained_keys);
+		free(q->retained_times);
+		free(q->retained_table.slots);
+		q->retained_keys = keys[0];
+		q->retained_times = times;
+		q->retained_next = kept % numPages;
+		table_init(&q->retained_table, numPages);
+		for(int i = 0; i < numPages; i++){
+			if(i >= kept){
+				q->retained_keys[i] = NO_KEY;
+				continue;
+			}
+			table_insert(&q->retained_table, q->retained_keys[i], i);
+		}
+	}
+	else if(q->strategy == RS_ARC){
+
+		// the longer ghost list gives up its oldest pages first
+		while(q->ghost_sizes[ARC_RECENT] + q->ghost_sizes[ARC_FREQUENT] > numPages){
+			list = q->ghost_sizes[ARC_RECENT] >= q->ghost_sizes[ARC_FREQUENT] ? ARC_RECENT : ARC_FREQUENT;
+			ghost_forget(q, q->ghost_lists[list].tail);
+		}
+
+		// collect the ghosts oldest first and add them again in that order
+		for(list = ARC_RECENT; list <= ARC_FREQUENT; list++){
+			keys[list] = malloc(sizeof(Page_Key)*(q->ghost_sizes[list] + 1));
+			num_keys[list] = 0;
+			for(int entry = q->ghost_lists[list].tail; entry != -1; entry = q->ghosts[entry].prev){
+				keys[list][num_keys[list]++] = q->ghosts[entry].key;
+			}
+			q->ghost_lists[list].head = -1;
+			q->ghost_lists[list].tail = -1;
+			q->ghost_sizes[list] = 0;
+		}
+
+		free(q->ghosts);
+		free(q->ghost_table.slots);
+		q->ghosts = malloc(sizeof(Ghost_Entry)*numPages);
+		table_init(&q->ghost_table, numPages);
+		q->ghost_free = -1;
+		for(int i = numPages - 1; i >= 0; i--){
+			q->ghosts[i].next = q->ghost_free;
+			q->ghost_free = i;
+		}
+		for(list = ARC_RECENT; list <= ARC_FREQUENT; list++){
+			for(int i = 0; i < num_keys[list]; i++){
+				ghost_add(q, list, keys[list][i]);
+			}
+			free(keys[list]);
+		}
+
+		q->arc_target = q->arc_target < numPages ? q->arc_target : numPages;
+	}
+}
 
-	// instantiate new page frame
-	Page_Frame new_frame;
+// NAME: resizeBufferPool
+// PURPOSE: change the number of frames of a live pool without losing the
+// pages it caches. Growing adds empty frames right away. Shrinking evicts
+// unpinned pages the way the strategy would on misses, dirty ones are
+// written back, until the rest fits, and hands the freed page buffers back
+// to the system. Hits and unpins go on while the pool resizes, they only wait
+// for the short moment the frames move. On a shared pool any handle resizes
+// the pool of every file.
+// PARAMS: 
+// - bm: active buffer pool
+// - newNumPages: new number of frames, at least 1
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY, RC_BUFFER_POOL_IN_USE if more pages
+// than that are pinned. The pool keeps its size then, pages evicted on the way
+// stay evicted.
+RC resizeBufferPool (BM_BufferPool *const bm, const int newNumPages){
+
+	Queue *q = pool_of(bm);
+	int numPages = newNumPages;
+	RC rc_return = RC_OK;
+
+	if(numPages < 1){
+		return RC_OUT_OF_MEMORY;
+	}
 
-	// file handle
-	SM_FileHandle fh;
+	pthread_mutex_lock(&q->pool_latch);
 
-	// pages needed to ensure capacity
-	int pages_needed = pageNum + 1;
+	if(numPages == q->max_entries){
+		pthread_mutex_unlock(&q->pool_latch);
+		bm->numPages = numPages;
+		return RC_OK;
+	}
 
-	// dequeue flags
-	bool dequeue_success; 
-	int dequeue_attempts = 0; 
+	// strategies fill frames in order, so the frames the evicted pages left
+	// are closed up even when the pool has to keep its size. Evicted buffers
+	// on their way to disk and prefetched buffers become free pages again.
+	// Writing evicted pages drops the pool latch, misses in between may fill
+	// the frames again.
+	do{
+		if(numPages < q->max_entries && !shed_frames(q, numPages)){
+			numPages = q->max_entries;
+			rc_return = RC_BUFFER_POOL_IN_USE;
+		}
+		drain_write_backs(q);
+		drop_prefetches(q);
+	}while(q->num_entries > numPages || q->num_pending > 0 || q->num_deferred > 0);
 
-	// initialize new page data
-	new_frame.page_num = pageNum;
-	new_frame.contents = (SM_PageHandle)malloc(PAGE_SIZE);
-	new_frame.fix_count = 0; 
-	new_frame.page_dirty = 0;
+	if(!add_pages(q, numPages + SPARE_PAGES - q->num_pages)){
+		unlock_pool(q);
+		return RC_OUT_OF_MEMORY;
+	}
 
-	//open file to read data from
-	openPageFile(bm->pageFile, &fh);
+	// no hit, unpin or markDirty can look at a frame while they move, and
+	// what they noted is folded in first
+	for(int i = 0; i < PAGE_TABLE_SHARDS; i++){
+		pthread_mutex_lock(&q->shards[i].latch);
+	}
+	fold_references(q, true);
+	resize_history(q, numPages);
+	resize_frames(q, numPages);
+	for(int i = PAGE_TABLE_SHARDS - 1; i >= 0; i--){
+		pthread_mutex_unlock(&q->shards[i].latch);
+	}
 
-	//ensure file has enough capacity for the frame
-	ensureCapacity(pages_needed, &fh);
+	retire_pages(q, numPages + SPARE_PAGES);
 
-	if(readBlock(pageNum, &fh, new_frame.contents) == RC_OK){
+	unlock_pool(q);
 
-		page->data = new_frame.contents;
-		page->pageNum = pageNum;
+	// the background writer keeps its share of dirty frames
+	pthread_mutex_lock(&q->writer_latch);
+	if(q->writer_running){
+		set_writer_threshold(q);
+	}
+	pthread_mutex_unlock(&q->writer_latch);
 
-		for(int i = 0; i < q->max_entries; i++){
-			
-			if(q->Page_Frame[i].page_num == pageNum){
+	bm->numPages = numPages;
+	return rc_return;
+}
 
-				// page found, return contents
-				page->data = q->Page_Frame[i].contents;
-				q->Page_Frame[i].fix_count++; 
+// NAME: compare_frame_pages
+// PURPOSE: qsort comparator that orders page frames by page number
+// PARAMS: 
+// - a, b: pointers to the page frames being compared
+// RETURN VAL: <0, 0, >0
+static int compare_frame_pages(const void *a, const void *b){
 
-				// close file
-				fclose(fh.mgmtInfo);
+	const Page_Frame *left = (const Page_Frame *)a;
+	const Page_Frame *right = (const Page_Frame *)b;
 
-				return true;  
+	return (left->page_num > right->page_num) - (left->page_num < right->page_num);
+}
 
-			}
-			else if(q->Page_Frame[i].page_num == -1){
+// NAME: forceFlushPool
+// PURPOSE: Writes all dirty pages of the handle's file back to disk. Dirty
+// pages are sorted by page number and every run of contiguous pages is written
+// with one vectored write. A page is marked clean before it is written, so a
+// client marking it dirty again during the write keeps it dirty. The pages are
+// pinned and written with the pool latch released.
+// PARAMS: 
+// - bm: buffer pool to shut down
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+RC forceFlushPool(BM_BufferPool *const bm){
 
-				// fill empty slots
-				enqueue(q, pageNum, new_frame);
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	Page_Frame *dirty_frames;
+	SM_PageHandle *run_pages;
+	SM_FileHandle fh;
+	Page_Shard *shard;
+	Page_Key key;
+	int num_dirty = 0;
+	int run_length;
+	int frame;
+	RC rc_return = RC_OK;
 
-				// increment files read
-				q->num_files_read++;
+	pthread_mutex_lock(&q->pool_latch);
 
-				// close numbers of files read
-				fclose(fh.mgmtInfo);
+	// finish evicted pages still on their way to disk, so the flush leaves the file current
+	drain_write_backs(q);
 
-				return true; 
+	dirty_frames = malloc(sizeof(Page_Frame) * q->max_entries);
+	run_pages = malloc(sizeof(SM_PageHandle) * q->max_entries);
 
-			}
+	// pin the dirty frames and mark them clean. Only misses, which hold the
+	// pool latch, change the page of a frame.
+	for (int i = 0; i < q->max_entries; i++){
+		if (q->Page_Frame[i].page_num == NO_PAGE || q->Page_Frame[i].file_id != file->file_id){
+			continue;
+		}
+		shard = shard_of(q, frame_key(q, i));
+		pthread_mutex_lock(&shard->latch);
+		pthread_mutex_lock(&q->frame_latches[i]);
+		if (q->Page_Frame[i].page_dirty != 0){
+			__atomic_add_fetch(&q->Page_Frame[i].fix_count, 1, __ATOMIC_ACQ_REL);
+			set_dirty(q, i, 0);
+			dirty_frames[num_dirty++] = q->Page_Frame[i];
 		}
-		
-		while ((dequeue_success = dequeue(q, bm)) != true){
+		pthread_mutex_unlock(&q->frame_latches[i]);
+		pthread_mutex_unlock(&shard->latch);
+	} 
 
-			printf("Can't dequeue! moving to next position in buffer");
+	// write through a copy of the handle, the writes move its position
+	fh = file->fh;
+	unlock_pool(q);
 
-			// if we have gone through the whole buffer without a successful dequeue, exit program
-			if(dequeue_attempts > q->max_entries){
+	// order dirty frames by page number so runs become adjacent
+	qsort(dirty_frames, num_dirty, sizeof(Page_Frame), compare_frame_pages);
 
-				printf("Could not remove pages from the buffer, please unpin a page to continue");
-				return false;
+	pthread_rwlock_rdlock(&q->file_latch);
+	for (int run_start = 0; run_start < num_dirty; run_start += run_length){
 
-			}
-			dequeue_attempts++; 
+		// extend the run while the next dirty page follows the previous one
+		run_length = 1;
+		while (run_start + run_length < num_dirty && 
+				dirty_frames[run_start + run_length].page_num == dirty_frames[run_start].page_num + run_length){
+			run_length++;
 		}
 
-		if(enqueue(q, pageNum, new_frame)){
-
-			// after enqueue, reset dequeue attempts
-			dequeue_attempts = 0; 
-
-			q->num_files_read++;
-
-			//close instance of page file to prevent memory leak
-			fclose(fh.mgmtInfo);
-			return true; 
+		for (int i = 0; i < run_length; i++){
+			run_pages[i] = dirty_frames[run_start + i].contents;
+		}
 
+		// write the whole run at once, the copies of a run that failed stay dirty
+		if (writeBlocks(dirty_frames[run_start].page_num, run_length, &fh, run_pages) != RC_OK){
+			for (int i = 0; i < run_length; i++){
+				dirty_frames[run_start + i].page_dirty = 1;
+			}
+			rc_return = RC_WRITE_FAILED;
+		}
+	}
+	pthread_rwlock_unlock(&q->file_latch);
+
+	// a page that could not be written is dirty again. A resize may have moved
+	// the pinned frames in the meantime.
+	pthread_mutex_lock(&q->pool_latch);
+	for (int i = 0; i < num_dirty; i++){
+		key = page_key(file->file_id, dirty_frames[i].page_num);
+		if (dirty_frames[i].page_dirty != 0){
+			frame = find_frame(q, key);
+			pthread_mutex_lock(&q->frame_latches[frame]);
+			set_dirty(q, frame, 1);
+			pthread_mutex_unlock(&q->frame_latches[frame]);
 		}
 		else{
-
-			// enqueue was not successful, close file and return error
-			fclose(fh.mgmtInfo);
-			return false; 
-
+			q->num_files_written++;
 		}
+		unpin_frame(q, key, NOTE_RELEASE);
 	}
 
-	else{
-		return false; 
+	// an evicted page of the file that could not be written is reported once
+	if (file->write_error != RC_OK){
+		rc_return = file->write_error;
+		file->write_error = RC_OK;
 	}
+
+	unlock_pool(q);
+
+	free(dirty_frames);
+	free(run_pages);
+	return rc_return; 
 }
 
-// NAME: LRU
-// PURPOSE: LRU page replacement strategy for buffer pool
+// NAME: markDirty
+// PURPOSE: marks specified page number as dirty
 // PARAMS: 
 // - bm: active buffer pool
-// - page: page we will be writing to disk
-// - pageNum: page number
-// RETURN VAL: true, false
-bool LRU(BM_BufferPool * const bm, BM_PageHandle * const page,
-		PageNumber pageNum){
-
-	// Get the queue handle
-	Queue *q = (Queue *)bm->mgmtData;
-
-	// instantiate new page frame
-	Page_Frame new_frame;
-
-	// file handle
-	SM_FileHandle fh;
-
-	// pages needed to ensure capacity
-	int pages_needed = pageNum + 1;
-
-	// initialize new page data
-	new_frame.page_num = pageNum;
+// - page: page we will be marking dirty
+// RETURN VAL: RC_OK
+RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page){
+	
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	Page_Key key = page_key(file->file_id, page->pageNum);
+	Page_Shard *shard = shard_of(q, key);
+	int frame;
+	int num_dirty = -1;
+	int threshold;
+
+	// the client holds a pin, so the frame keeps the page. The shard latch
+	// keeps a resize from moving it.
+	pthread_mutex_lock(&shard->latch);
+	frame = table_find(&shard->table, key);
+	if (frame != -1){
+		pthread_mutex_lock(&q->frame_latches[frame]);
+		if (q->Page_Frame[frame].page_dirty == 0){
+			num_dirty = set_dirty(q, frame, 1);
+		}
+		pthread_mutex_unlock(&q->frame_latches[frame]);
+	}
+	pthread_mutex_unlock(&shard->latch);
+
+	// wake the background writer when this page made the pool too dirty
+	threshold = __atomic_load_n(&q->writer_threshold, __ATOMIC_RELAXED);
+	if (threshold > 0 && num_dirty == threshold){
+		pthread_mutex_lock(&q->writer_latch);
+		pthread_cond_signal(&q->writer_wake);
+		pthread_mutex_unlock(&q->writer_latch);
+	}
 
-	new_frame.contents = (SM_PageHandle)malloc(PAGE_SIZE);
+	return RC_OK; 
 
-	new_frame.fix_count = 0; 
+}
 
-	new_frame.page_dirty = 0;
+// NAME: unpinPage
+// PURPOSE: decrements the fix count from specifed page
+// PARAMS: 
+// - bm: active buffer pool
+// - page: page we will be unpinning
+// RETURN VAL: RC_OK
+RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page){
 
-	new_frame.num_hit++;
+	Pool_File *file = (Pool_File *)bm->mgmtData;
 
-	//open file to read data from
-	openPageFile(bm->pageFile, &fh);
+	// releasing the last pin makes the frame a candidate victim again, which
+	// the strategy folds into its state on the next miss
+	unpin_frame(file->pool, page_key(file->file_id, page->pageNum), NOTE_UNPIN);
+	return RC_OK;
+}
 
-	//ensure file has enough capacity for the frame
-	ensureCapacity(pages_needed, &fh);
+// NAME: forcePage
+// PURPOSE: forces a page to be written to the disk
+// PARAMS: 
+// - bm: active buffer pool
+// - page: page we will be writing to disk
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_WRITE_FAILED
+RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page){
 
-	if(readBlock(pageNum, &fh, new_frame.contents) == RC_OK){
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	Page_Key key = page_key(file->file_id, page->pageNum);
+	SM_PageHandle contents;
+	SM_FileHandle fh;
+	int frame;
+	RC rc;
 
-		page->data = new_frame.contents;
-		page->pageNum = pageNum;
+	pthread_mutex_lock(&q->pool_latch);
 
-		for(int i = 0; i < q->max_entries; i++){
-			
-			if(q->Page_Frame[i].page_num == pageNum){
+	// a copy the background writer took earlier must not overwrite this write
+	wait_for_write_back(q, file, page->pageNum);
 
-				page->data = q->Page_Frame[i].contents;
-				q->Page_Frame[i].fix_count++; 
-				fclose(fh.mgmtInfo);
-				return true;  
+	// the pin keeps the page in its frame while the pool latch is released
+	frame = pin_frame(q, key, &contents, false);
+	if (frame == -1){
+		unlock_pool(q);
+		return RC_FILE_NOT_FOUND;
+	}
 
-			}
-			else if(q->Page_Frame[i].page_num == -1){
+	// mark page as clean, a client marking it dirty during the write keeps it dirty
+	pthread_mutex_lock(&q->frame_latches[frame]);
+	set_dirty(q, frame, 0);
+	pthread_mutex_unlock(&q->frame_latches[frame]);
 
-				enqueue(q, pageNum, new_frame);
+	// write through a copy of the handle, the write moves its position
+	fh = file->fh;
+	pthread_mutex_unlock(&q->pool_latch);
 
-				q->num_files_read++;
+	pthread_rwlock_rdlock(&q->file_latch);
+	rc = writeBlock(page->pageNum, &fh, contents);
+	pthread_rwlock_unlock(&q->file_latch);
 
-				fclose(fh.mgmtInfo);
-				return true; 
+	pthread_mutex_lock(&q->pool_latch);
 
-			}
-		}
+	// a page that could not be written is dirty again
+	if (rc != RC_OK){
+		frame = find_frame(q, key);
+		pthread_mutex_lock(&q->frame_latches[frame]);
+		set_dirty(q, frame, 1);
+		pthread_mutex_unlock(&q->frame_latches[frame]);
+		rc = RC_WRITE_FAILED;
 	}
 	else{
-		return false; 
+		// increment the number of files written
+		q->num_files_written++; 
 	}
+
+	unpin_frame(q, key, NOTE_RELEASE);
+	unlock_pool(q);
+	return rc;
 }
 
-// NAME: shutdownBufferPool
-// PURPOSE: frees up all memory associated with the buffer pool 
+// NAME: place_frame
+// PURPOSE: place a page that was just read in the frame the strategy of the
+// pool picks, pinned. The pool latch is held.
 // PARAMS: 
-// - bm: buffer pool to shut down
-// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND
-RC shutdownBufferPool(BM_BufferPool *const bm){
-
-	Queue *q = (Queue *)bm->mgmtData;
-
-	// write all dirty pages back to disk
-	forceFlushPool(bm);
+// - bm: active buffer pool
+// - new_frame: page that was just read
+// RETURN VAL: true, false if every frame is pinned
+static bool place_frame(BM_BufferPool *const bm, Page_Frame new_frame){
 
-	for(int i = 0; i < q->max_entries; i++)
-	{
-		// If fixCount != 0, it means that the contents of the page was modified by some client and has not been written back to disk.
-		if(q->Page_Frame[i].fix_count > 0)
-		{
-			// return error code
-			return RC_PAGE_NOT_FOUND;
-		}
+	fold_references(pool_of(bm), false);
+	if(bm->strategy == RS_FIFO){
+		return FIFO(bm, new_frame);
 	}
-
-	// Releasing space occupied by the page
-	free(q);
-	bm->mgmtData = NULL;
-	return RC_OK; 
-
+	else if(bm->strategy == RS_LRU){
+		return LRU(bm, new_frame);
+	}
+	else if(bm->strategy == RS_CLOCK){
+		return CLOCK(bm, new_frame);
+	}
+	else if(bm->strategy == RS_LFU){
+		return LFU(bm, new_frame);
+	}
+	else if(bm->strategy == RS_LRU_K){
+		return LRU_K(bm, new_frame);
+	}
+	else if(bm->strategy == RS_ARC){
+		return ARC(bm, new_frame);
+	}
+	return false;
 }
 
-// NAME: forceFlushPool
-// PURPOSE: Writes all dirty pages back to disk 
+// NAME: ring_frame
+// PURPOSE: find the frame that still holds the page of a scan ring slot
 // PARAMS: 
-// - bm: buffer pool to shut down
-// RETURN VAL: RC_OK
-RC forceFlushPool(BM_BufferPool *const bm){
-
-	// Page_Frame *pf = (Page_Frame *) bm->mgmtData;
-	Queue *q = (Queue *)bm->mgmtData;
-	SM_FileHandle fh; 
+// - q: queue of the active buffer pool
+// - ring: scan ring
+// - slot: slot of the ring
+// RETURN VAL: frame index, -1 if the slot is unused or its page was evicted
+static int ring_frame(Queue *q, Scan_Ring *ring, int slot){
+
+	if(ring->keys[slot] == NO_KEY){
+		return -1;
+	}
+	return find_frame(q, ring->keys[slot]);
+}
 
-	for (int i = 0; i < q->max_entries; i++){
+// NAME: ring_push
+// PURPOSE: record a page a scan placed in the pool in the oldest ring slot
+// PARAMS: 
+// - ring: scan ring
+// - key: page that was placed
+// RETURN VAL: none
+static void ring_push(Scan_Ring *ring, Page_Key key){
+	ring->keys[ring->next] = key;
+	ring->next = (ring->next + 1) % ring->size;
+}
 
-		//find the page the user is requesting
-		if (q->Page_Frame[i].page_dirty != 0){
+// NAME: recycle_frame
+// PURPOSE: put a page a scan read into the frame of the oldest page of its
+// ring, pinned, without asking the strategy for a victim. The frame keeps its
+// place in FIFO and CLOCK order, the other strategies see a new page, and the
+// page it held leaves no LRU-K history or ARC ghost behind. The pool latch is
+// held.
+// PARAMS: 
+// - q: queue of the active buffer pool
+// - ring: scan ring
+// - new_frame: page that was just read
+// RETURN VAL: frame index, -1 if the ring has no unpinned frame to reuse
+static int recycle_frame(Queue *q, Scan_Ring *ring, Page_Frame new_frame){
+
+	int frame;
+
+	fold_references(q, false);
+	frame = ring_frame(q, ring, ring->next);
+	if(frame == -1 || !drop_frame(q, frame, false)){
+		return -1;
+	}
 
-			//decrement fix count
-			q->Page_Frame[i].page_dirty = 0; 
-			openPageFile(bm->pageFile, &fh);
-			writeBlock(q->Page_Frame[i].page_num, &fh, q->Page_Frame[i].contents);
-			fclose(fh.mgmtInfo);
-			q->num_files_written++;
-		}
-	} 
+	install_frame(q, frame, new_frame);
+	if(q->strategy == RS_LFU){
+		q->Page_Frame[frame].num_hit = 1;
+	}
+	else if(q->strategy == RS_LRU_K){
+		lru_k_restore(q, frame);
+		lru_k_reference(q, frame);
+	}
+	else if(q->strategy == RS_ARC){
+		q->Page_Frame[frame].arc_list = ARC_RECENT;
+		list_push_front(q, &q->arc_lists[ARC_RECENT], frame);
+		q->arc_sizes[ARC_RECENT]++;
+	}
+	ring_push(ring, frame_key(q, frame));
 
-	return RC_OK; 
+	q->num_files_read++;
+	return frame;
 }
 
-// NAME: markDirty
-// PURPOSE: marks specified page number as dirty
+// NAME: ring_read_ahead
+// PURPOSE: read the pages following a page a scan missed on into the next
+// frames of its ring, unpinned, with one vectored read. Read-ahead only ever
+// reuses ring frames, so it starts once the ring is full and never evicts a
+// page the scan did not place. The pool latch is held, it is released while
+// the run is read.
 // PARAMS: 
+// - q: queue of the active buffer pool
 // - bm: active buffer pool
-// - page: page we will be marking dirty
-// RETURN VAL: RC_OK
-RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page){
-	
-	// Page_Frame *pf = (Page_Frame *) bm->mgmtData;
-	Queue *q = (Queue *)bm->mgmtData;
-
-	for (int i = 0; i < q->max_entries; i++){
+// - ring: scan ring
+// - startPage: first page to read
+// RETURN VAL: none
+static void ring_read_ahead(Queue *q, BM_BufferPool *const bm, Scan_Ring *ring, PageNumber startPage){
+
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	SM_PageHandle run_pages[READ_AHEAD_RUN];
+	unsigned int run_stamps[READ_AHEAD_RUN];
+	Page_Frame new_frame;
+	SM_FileHandle fh;
+	Page_Key key;
+	bool read_ok;
+	int max_length = ring->size - 1 < READ_AHEAD_RUN ? ring->size - 1 : READ_AHEAD_RUN;
+	int run_length = 0;
+	int frame;
+	PageNumber pageNum;
+
+	// the slot of the page just missed is the newest and is not reused. The
+	// run ends at a page in the pool or on its way to disk, at the end of the
+	// file and at a slot whose page was evicted.
+	while(run_length < max_length){
+		pageNum = startPage + run_length;
+		if(pageNum >= file->fh.totalNumPages || find_frame(q, page_key(file->file_id, pageNum)) != -1
+				|| write_back_in_flight(q, file, pageNum)
+				|| ring_frame(q, ring, (ring->next + run_length) % ring->size) == -1
+				|| (run_pages[run_length] = take_page(q)) == NULL){
+			break;
+		}
+		run_stamps[run_length] = *evict_stamp(q, page_key(file->file_id, pageNum));
+		run_length++;
+	}
+	if(run_length == 0){
+		return;
+	}
 
-		// if page isn't empty
-		if (q->Page_Frame[i].page_num != -1 && q->Page_Frame[i].page_num == page->pageNum){
+	// read through a copy of the handle, the read moves its position
+	fh = file->fh;
+	pthread_mutex_unlock(&q->pool_latch);
+	pthread_rwlock_rdlock(&q->file_latch);
+	read_ok = readBlocks(startPage, run_length, &fh, run_pages) == RC_OK;
+	pthread_rwlock_unlock(&q->file_latch);
+	pthread_mutex_lock(&q->pool_latch);
+
+	if(!read_ok){
+		for(int i = 0; i < run_length; i++){
+			release_page(q, run_pages[i]);
+		}
+		return;
+	}
 
-			q->Page_Frame[i].page_dirty = 1; 
+	for(int i = 0; i < run_length; i++){
 
-			return RC_OK; 
+		// another thread may have placed or evicted the page during the read
+		key = page_key(file->file_id, startPage + i);
+		if(find_frame(q, key) != -1 || *evict_stamp(q, key) != run_stamps[i]){
+			release_page(q, run_pages[i]);
+			continue;
 		}
-	}
 
-	return RC_OK; 
+		new_frame.page_num = startPage + i;
+		new_frame.file_id = file->file_id;
+		new_frame.contents = run_pages[i];
+		new_frame.fix_count = 0; 
+		new_frame.page_dirty = 0;
+		new_frame.num_hit = 0;
+		new_frame.ref_bit = 0;
+
+		// a hit may have pinned the ring frame since the run was planned
+		if((frame = recycle_frame(q, ring, new_frame)) == -1){
+			release_page(q, run_pages[i]);
+			continue;
+		}
 
+		// drop the pin recycle_frame took, a hit may have pinned the page already
+		__atomic_sub_fetch(&q->Page_Frame[frame].fix_count, 1, __ATOMIC_ACQ_REL);
+		sync_frame(bm, q, frame);
+	}
 }
 
-// NAME: unpinPage
-// PURPOSE: decrements the fix count from specifed page
+// NAME: reap_prefetches
+// PURPOSE: collect finished prefetches and place their pages in the pool
+// unpinned, through any handle of the pool. A page that could not be read,
+// that is in the pool already, or that was evicted since its read started
+// and may be newer on disk now is dropped. The pool latch is held.
 // PARAMS: 
 // - bm: active buffer pool
-// - page: page we will be unpinning
-// RETURN VAL: RC_OK
-RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page){
-
-	// Page_Frame *pf = (Page_Frame *) bm->mgmtData;
-	Queue *q = (Queue *)bm->mgmtData;
+// - q: queue of the active buffer pool
+// - minCompletions: number of prefetches to wait for
+// RETURN VAL: none
+static void reap_prefetches(BM_BufferPool *const bm, Queue *q, int minCompletions){
+
+	SM_Completion completions[PREFETCH_DEPTH];
+	int num_done = reapCompletions(&q->read_queue, completions, PREFETCH_DEPTH, minCompletions);
+	Pending_Read read;
+	Page_Frame new_frame;
+	Page_Key key;
+	int frame;
 
-	for (int i = 0; i < q->max_entries; i++){
-		//find the page the user is requesting
-		// if (pf[i].page_num == page->pageNum){
-		if (q->Page_Frame[i].fix_count > 0 && q->Page_Frame[i].page_num == page->pageNum){
+	for(int k = 0; k < num_done; k++){
 
-			//decrement fix count
-			q->Page_Frame[i].fix_count--; 
+		take_prefetch(q, &completions[k], &read);
+		key = page_key(read.file->file_id, read.page_num);
+		if(completions[k].rc != RC_OK || read.stamp != *evict_stamp(q, key) || find_frame(q, key) != -1){
+			release_page(q, read.contents);
+			continue;
+		}
 
+		new_frame.page_num = read.page_num;
+		new_frame.file_id = read.file->file_id;
+		new_frame.contents = read.contents;
+		new_frame.fix_count = 0; 
+		new_frame.page_dirty = 0;
+		new_frame.num_hit = 0;
+		new_frame.ref_bit = 0;
+
+		// every frame is pinned
+		if(!place_frame(bm, new_frame)){
+			release_page(q, read.contents);
+			continue;
 		}
-	} 
-	return RC_OK;
+
+		// drop the pin the strategy took, a hit may have pinned the page already
+		frame = find_frame(q, key);
+		q->Page_Frame[frame].prefetched = 1;
+		__atomic_sub_fetch(&q->Page_Frame[frame].fix_count, 1, __ATOMIC_ACQ_REL);
+		sync_frame(bm, q, frame);
+	}
 }
 
-// NAME: forcePage
-// PURPOSE: forces a page to be written to the disk
+// NAME: pin_page
+// PURPOSE: pin a page for pinPage and pinPageScan. A hit is the same for both.
+// A miss of a scan reuses the frame of the oldest page of its ring and reads
+// the following pages ahead into the ring, a miss without a ring or whose
+// ring has no frame to reuse asks the strategy for a victim.
 // PARAMS: 
 // - bm: active buffer pool
-// - page: page we will be writing to disk
+// - page: page handle
+// - pageNum: page that we will be pinning
+// - ring: scan ring of the caller, NULL for an ordinary pin
 // RETURN VAL: RC_OK, RC_FILE_NOT_FOUND
-RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page){
+static RC pin_page(BM_BufferPool *const bm, BM_PageHandle *const page, 
+		const PageNumber pageNum, Scan_Ring *ring){
 
-	// Page_Frame *pf = (Page_Frame *) bm->mgmtData;
-	Queue *q = (Queue *)bm->mgmtData;
-	SM_FileHandle fh; 
-
-	for (int i = 0; i < q->max_entries; i++){
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	Page_Key key = page_key(file->file_id, pageNum);
+	Page_Frame new_frame;
 
-		//find the page the user is requesting
-		if (q->Page_Frame[i].page_num == page->pageNum){
+	page->pageNum = pageNum;
 
-			//open page file
-			openPageFile(bm->pageFile, &fh);
+	// a hit only takes the latch of its page table shard, the strategy folds
+	// it into its state on the next miss
+	if(pin_frame(q, key, &page->data, true) != -1){
+		return RC_OK;
+	}
 
-			// write the contents of the page
-			writeBlock(q->Page_Frame[i].page_num, &fh, q->Page_Frame[i].contents);
+	// a prefetch of the page may be on its way, it is waited for instead of
+	// reading the page again. Other finished prefetches are placed as well.
+	if(__atomic_load_n(&q->num_prefetches, __ATOMIC_ACQUIRE) > 0){
+		pthread_mutex_lock(&q->pool_latch);
+		while(prefetch_in_flight(q, file, pageNum)){
+			reap_prefetches(bm, q, 1);
+		}
+		reap_prefetches(bm, q, 0);
+		if(pin_frame(q, key, &page->data, true) != -1){
+			unlock_pool(q);
+			return RC_OK;
+		}
+		unlock_pool(q);
+	}
 
-			//close instance of page file to prevent memory leak
-			fclose(fh.mgmtInfo);
+	// a miss reads the page without a latch, then places it under the pool latch
+	if(!read_frame(q, file, pageNum, &new_frame)){
+		unlock_pool(q);
+		return RC_FILE_NOT_FOUND;
+	}
 
-			// mark page as clean
-			q->Page_Frame[i].page_dirty = 0;  
+	// another thread may have placed the page while it was read
+	if(pin_frame(q, key, &page->data, true) != -1){
+		release_page(q, new_frame.contents);
+		unlock_pool(q);
+		return RC_OK;
+	}
 
-			// increment the number of files written
-			q->num_files_written++; 
+	// every frame is pinned
+	if(!(ring != NULL && recycle_frame(q, ring, new_frame) != -1) && !place_frame(bm, new_frame)){
+		release_page(q, new_frame.contents);
+		unlock_pool(q);
+		return RC_FILE_NOT_FOUND;
+	}
 
-			return RC_OK;
+	// a page the strategy placed joins the ring, whose oldest page it replaces
+	if(ring != NULL){
+		if(ring->keys[(ring->next + ring->size - 1) % ring->size] != key){
+			ring_push(ring, key);
 		}
-	} 
-	return RC_FILE_NOT_FOUND;
+		ring_read_ahead(q, bm, ring, pageNum + 1);
+	}
+
+	unlock_pool(q);
+	page->data = new_frame.contents;
+	return RC_OK;
 }
 
 // NAME: pinPage
@@ -452,55 +4074,171 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page){
 // - bm: active buffer pool
 // - page: page handle
 // - pageNum: page that we will be pinning
-// RETURN VAL: RC_OK
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum){
+	return pin_page(bm, page, pageNum, NULL);
+}
 
-	if(bm->strategy == RS_FIFO){
-		if(FIFO(bm, page, pageNum)){
-			
-			return RC_OK; 
+// NAME: initScanRing
+// PURPOSE: set up a ring of frames for one sequential scan. Pages the scan
+// misses on through pinPageScan replace the oldest page of its ring instead
+// of a page the strategy picks, so a scan of any length takes 'numFrames'
+// frames from the rest of the pool and leaves its working set alone. The ring
+// is filled from the pool like ordinary misses, and a page of the ring that
+// was evicted or is pinned in the meantime is replaced the same way.
+// PARAMS: 
+// - bm: active buffer pool
+// - ring: ring to set up
+// - numFrames: frames of the ring, at most a quarter of the pool is used
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY
+RC initScanRing (BM_BufferPool *const bm, BM_ScanRing *const ring, const int numFrames){
 
-		}
-		else{
+	Queue *q = pool_of(bm);
+	Scan_Ring *scan_ring = (Scan_Ring *) malloc(sizeof(Scan_Ring));
+	int size = numFrames < q->max_entries / 4 ? numFrames : q->max_entries / 4;
 
-			return RC_FILE_NOT_FOUND;
+	if(scan_ring == NULL){
+		return RC_OUT_OF_MEMORY;
+	}
+	scan_ring->size = size > 1 ? size : 1;
+	scan_ring->next = 0;
+	scan_ring->keys = (Page_Key *) malloc(sizeof(Page_Key) * scan_ring->size);
+	if(scan_ring->keys == NULL){
+		free(scan_ring);
+		return RC_OUT_OF_MEMORY;
+	}
+	for(int i = 0; i < scan_ring->size; i++){
+		scan_ring->keys[i] = NO_KEY;
+	}
 
-		}
+	ring->numFrames = scan_ring->size;
+	ring->mgmtData = scan_ring;
+	return RC_OK;
+}
+
+// NAME: pinPageScan
+// PURPOSE: pin a page for a sequential scan. A hit is an ordinary hit, a miss
+// reuses a frame of the scan's ring and reads the pages after it ahead into
+// the ring.
+// PARAMS: 
+// - bm: active buffer pool
+// - ring: ring of the scan, see initScanRing
+// - page: page handle
+// - pageNum: page that we will be pinning
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND
+RC pinPageScan (BM_BufferPool *const bm, BM_ScanRing *const ring, 
+		BM_PageHandle *const page, const PageNumber pageNum){
+	return pin_page(bm, page, pageNum, (Scan_Ring *)ring->mgmtData);
+}
+
+// NAME: closeScanRing
+// PURPOSE: release a scan ring. Its pages stay in the pool and age out like
+// any other page.
+// PARAMS: 
+// - ring: ring to release
+// RETURN VAL: RC_OK
+RC closeScanRing (BM_ScanRing *const ring){
+
+	Scan_Ring *scan_ring = (Scan_Ring *)ring->mgmtData;
+
+	if(scan_ring != NULL){
+		free(scan_ring->keys);
+		free(scan_ring);
 	}
-	else if(bm->strategy == RS_LRU){
-		if(LRU(bm, page, pageNum)){
+	ring->mgmtData = NULL;
+	return RC_OK;
+}
 
-			return RC_OK;
+// NAME: prefetchPages
+// PURPOSE: start reading pages the caller is about to pin and return right
+// away. Each page is read asynchronously into a spare page buffer, and once a
+// later pinPage or prefetchPages finds its read finished it is placed in the
+// pool unpinned, in the frame the strategy picks. A pinPage of a page still
+// being read waits for that read instead of reading the page again.
+// Prefetching is only a hint: pages in the pool, pages on their way to disk
+// and pages past the end of the file are skipped, and at most PREFETCH_DEPTH
+// pages, and never more than half the pool, are read at once.
+// PARAMS: 
+// - bm: active buffer pool
+// - pageNums: pages to prefetch, in the order they should be read
+// - n: number of pages in 'pageNums'
+// RETURN VAL: RC_OK
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *const pageNums, 
+		const int n){
+
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	Pending_Read *read;
+	SM_PageHandle contents;
+	PageNumber pageNum;
+	Page_Key key;
+
+	pthread_mutex_lock(&q->pool_latch);
+
+	// without an engine the pages are simply read when they are pinned
+	if(!start_async_queue(&q->read_queue, PREFETCH_DEPTH)){
+		pthread_mutex_unlock(&q->pool_latch);
+		return RC_OK;
+	}
 
-		}
-		else{
+	// place what finished since the last time, that makes room for more
+	reap_prefetches(bm, q, 0);
 
-			return RC_FILE_NOT_FOUND;
+	for(int i = 0; i < n && q->num_prefetches < PREFETCH_DEPTH && q->num_prefetches < q->max_entries / 2; i++){
 
+		pageNum = pageNums[i];
+		key = page_key(file->file_id, pageNum);
+		if(pageNum < 0 || pageNum >= file->fh.totalNumPages || find_frame(q, key) != -1
+				|| prefetch_in_flight(q, file, pageNum) || write_back_in_flight(q, file, pageNum)){
+			continue;
 		}
-	}
 
-	else{
-		return RC_FILE_NOT_FOUND;
+		if((contents = take_page(q)) == NULL){
+			break;
+		}
+		if(submitReadBlock(&q->read_queue, pageNum, &file->fh, contents, contents) != RC_OK){
+			release_page(q, contents);
+			break;
+		}
+
+		// an eviction of the page from now on makes the read stale
+		read = &q->prefetches[q->num_prefetches];
+		read->file = file;
+		read->page_num = pageNum;
+		read->contents = contents;
+		read->stamp = *evict_stamp(q, key);
+		__atomic_add_fetch(&q->num_prefetches, 1, __ATOMIC_RELEASE);
 	}
 
+	unlock_pool(q);
+
+	return RC_OK;
 }
 
 // NAME: getFrameContents
-// PURPOSE: Returns the pages found in the frames of the buffer pool
+// PURPOSE: Returns the pages found in the frames of the buffer pool. Frames of
+// a shared pool that hold pages of other files count as empty. The statistics
+// calls also update bm->numPages, so a handle of a pool another handle
+// resized learns its new size.
 // PARAMS: 
 // - bm: active buffer pool
 // RETURN VAL: page numbers
 PageNumber *getFrameContents (BM_BufferPool *const bm){
 
-	PageNumber *page_numbers = malloc(sizeof(int)*bm->numPages);
-	Queue *q = (Queue *)bm->mgmtData;
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	PageNumber *page_numbers;
+
+	pthread_mutex_lock(&q->pool_latch);
+
+	bm->numPages = q->max_entries;
+	page_numbers = malloc(sizeof(int)*bm->numPages);
 
 	for (int i = 0; i < q->max_entries; i++){
 
 		//if page info is not null
-		if(q->Page_Frame[i].page_num != -1){
+		if(q->Page_Frame[i].page_num != -1 && q->Page_Frame[i].file_id == file->file_id){
 
 			page_numbers[i] = q->Page_Frame[i].page_num; 
 
@@ -512,6 +4250,8 @@ PageNumber *getFrameContents (BM_BufferPool *const bm){
 
 		}
 	}
+	pthread_mutex_unlock(&q->pool_latch);
+
 	//return pagenumber array
 	return page_numbers; 
 }
@@ -523,12 +4263,19 @@ PageNumber *getFrameContents (BM_BufferPool *const bm){
 // RETURN VAL: page numbers
 bool *getDirtyFlags (BM_BufferPool *const bm){
 	
-	bool *dirty_flags = malloc(sizeof(bool)*bm->numPages);
-	Queue *q = (Queue *)bm->mgmtData;
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	bool *dirty_flags;
+
+	pthread_mutex_lock(&q->pool_latch);
+
+	bm->numPages = q->max_entries;
+	dirty_flags = malloc(sizeof(bool)*bm->numPages);
 
 	for (int i = 0; i < q->max_entries; i++){
 
-		if(q->Page_Frame[i].page_dirty != 0){
+		pthread_mutex_lock(&q->frame_latches[i]);
+		if(q->Page_Frame[i].page_dirty != 0 && q->Page_Frame[i].file_id == file->file_id){
 
 			dirty_flags[i] = true; 
 
@@ -538,7 +4285,10 @@ bool *getDirtyFlags (BM_BufferPool *const bm){
 			dirty_flags[i] = false;
 
 		}
+		pthread_mutex_unlock(&q->frame_latches[i]);
 	}
+	pthread_mutex_unlock(&q->pool_latch);
+
 	//return dirty flags array
 	return dirty_flags; 
 }
@@ -550,36 +4300,66 @@ bool *getDirtyFlags (BM_BufferPool *const bm){
 // RETURN VAL: the number of users who are currently editing the pages
 int *getFixCounts (BM_BufferPool *const bm){
 
-	int *fix_counts = malloc(sizeof(int)*bm->numPages);
-	Queue *q = (Queue *)bm->mgmtData;
+	Pool_File *file = (Pool_File *)bm->mgmtData;
+	Queue *q = file->pool;
+	int *fix_counts;
 
-	int i = 0;
+	pthread_mutex_lock(&q->pool_latch);
+
+	bm->numPages = q->max_entries;
+	fix_counts = malloc(sizeof(int)*bm->numPages);
 
 	// Iterating through all the pages in the buffer pool and setting fixCounts' value to page's fixCount
 	for (int i = 0; i < q->max_entries; i++){
 	
-		fix_counts[i] = (q->Page_Frame[i].fix_count != -1) ? q->Page_Frame[i].fix_count : 0;
+		fix_counts[i] = __atomic_load_n(&q->Page_Frame[i].fix_count, __ATOMIC_ACQUIRE);
+		fix_counts[i] = (fix_counts[i] != -1 && q->Page_Frame[i].file_id == file->file_id) ? fix_counts[i] : 0;
 
 	}
+	pthread_mutex_unlock(&q->pool_latch);
+
 	return fix_counts; 
 }
 
 // NAME: getNumReadIO
-// PURPOSE: Returns the number of pages that have been read from the disk
+// PURPOSE: Returns the number of pages that have been read from the disk, by
+// every file of a shared pool
 // PARAMS: 
 // - bm: active buffer pool
 // RETURN VAL: the number of total reads
 int getNumReadIO (BM_BufferPool *const bm){
-	Queue *q = (Queue *)bm->mgmtData;
+	Queue *q = pool_of(bm);
 	return q->num_files_read; 
 }
 
 // NAME: getNumWriteIO
-// PURPOSE: Returns the number of pages that have been written to the disk
+// PURPOSE: Returns the number of pages that have been written to the disk, by
+// every file of a shared pool
 // PARAMS: 
 // - bm: active buffer pool
 // RETURN VAL: the number of total writes
 int getNumWriteIO (BM_BufferPool *const bm){
-	Queue *q = (Queue *)bm->mgmtData;
+	Queue *q = pool_of(bm);
 	return q->num_files_written; 
+}
+
+// NAME: getNumCleanEvictions
+// PURPOSE: Returns the number of evicted frames that were not modified and
+// were dropped without a write
+// PARAMS: 
+// - bm: active buffer pool
+// RETURN VAL: the number of clean evictions
+int getNumCleanEvictions (BM_BufferPool *const bm){
+	Queue *q = pool_of(bm);
+	return q->num_clean_evictions; 
+}
+
+// NAME: getNumDirtyEvictions
+// PURPOSE: Returns the number of evicted frames that had to be written back
+// PARAMS: 
+// - bm: active buffer pool
+// RETURN VAL: the number of dirty evictions
+int getNumDirtyEvictions (BM_BufferPool *const bm){
+	Queue *q = pool_of(bm);
+	return q->num_dirty_evictions; 
 }
\ No newline at end of file
@@ -13,7 +13,8 @@ typedef enum ReplacementStrategy {
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5
 } ReplacementStrategy;
 
 // Data Types and Structures
@@ -33,6 +34,12 @@ typedef struct BM_PageHandle {
 	char *data;
 } BM_PageHandle;
 
+// ring of frames a sequential scan reuses, see initScanRing
+typedef struct BM_ScanRing {
+	int numFrames;
+	void *mgmtData;
+} BM_ScanRing;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -46,6 +53,13 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 		void *stratData);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC resizeBufferPool (BM_BufferPool *const bm, const int newNumPages);
+
+// Shared Buffer Pool Interface, one pool caching the pages of several files
+RC initSharedBufferPool(const size_t memoryBudget, ReplacementStrategy strategy,
+		void *stratData);
+RC openSharedBufferPool(BM_BufferPool *const bm, const char *const pageFileName);
+RC shutdownSharedBufferPool(void);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,6 +67,18 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber *const pageNums, 
+		const int n);
+
+// Buffer Manager Interface Scan Rings, scans that leave the working set alone
+RC initScanRing (BM_BufferPool *const bm, BM_ScanRing *const ring, const int numFrames);
+RC pinPageScan (BM_BufferPool *const bm, BM_ScanRing *const ring, 
+		BM_PageHandle *const page, const PageNumber pageNum);
+RC closeScanRing (BM_ScanRing *const ring);
+
+// Buffer Manager Interface Background Writer
+RC startBackgroundWriter (BM_BufferPool *const bm, const int dirtyPercent);
+RC stopBackgroundWriter (BM_BufferPool *const bm);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -60,5 +86,7 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumCleanEvictions (BM_BufferPool *const bm);
+int getNumDirtyEvictions (BM_BufferPool *const bm);
 
 #endif
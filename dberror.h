@@ -5,6 +5,7 @@
 
 /* module wide constants */
 #define PAGE_SIZE 4096
+#define PAGE_ALIGNMENT 4096 // alignment of page buffers for direct I/O
 
 /* return code definitions */
 typedef int RC;
@@ -23,6 +24,12 @@ typedef int RC;
 #define RC_DESTROY_PAGE_ERROR 11
 #define RC_NO_FREE_SLOT 12
 #define RC_TOMBSTONE_NOT_FOUND 12
+#define RC_ASYNC_QUEUE_FULL 13
+#define RC_ASYNC_INIT_FAILED 14
+#define RC_BAD_FILE_FORMAT 15
+#define RC_OUT_OF_MEMORY 16
+#define RC_BUFFER_POOL_IN_USE 17
+#define RC_BUFFER_POOL_NOT_INIT 18
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
@@ -4,6 +4,18 @@
 
 // Globals
 
+// number of frames a sequential scan cycles through, so a scan of a large
+// table leaves the pages other tables work on in the buffer pool
+#define SCAN_RING_FRAMES 16
+
+// share of dirty frames in percent at which the buffer pool starts writing
+// pages back in the background
+#define RM_DIRTY_PERCENT 25
+
+// memory of the buffer pool all tables share, unless initRecordManager is
+// given another budget
+#define RM_POOL_BUDGET (200 * PAGE_SIZE)
+
 // global schema
 Schema *rm_schema; 
 
@@ -34,44 +46,47 @@ typedef struct Record_Manager
     // scan counter
     int num_scanned; 
 
-    // capacity of our buffer pool 
-    int buffer_pool_capacity; 
-
     // first free page tracker
     int first_free_page; 
 
+    // frames a scan reuses for the pages it reads
+    BM_ScanRing ring;
+
 } Record_Manager;
 
 // initialize pointer to the record manager
 Record_Manager *rm;
 
 // NAME: initRecordManager
-// PURPOSE: initialize the record manager. This calls initStorageManager so we can begin writing files to disk
+// PURPOSE: initialize the record manager. This calls initStorageManager so we can begin writing files to disk,
+// and creates the buffer pool the pages of all tables share
 // PARAMS: 
-// - mgmtData: void data pointer
-// RETURN VAL: RC_OK
+// - mgmtData: pointer to the memory budget of the buffer pool in bytes, NULL for RM_POOL_BUDGET
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY, RC_ASYNC_INIT_FAILED, RC_BUFFER_POOL_IN_USE
 extern RC initRecordManager (void *mgmtData){
 
+    size_t budget = (mgmtData != NULL) ? *(size_t *)mgmtData : RM_POOL_BUDGET;
+
     // initialize storage manager
     initStorageManager();
 
-    // return success
-    return RC_OK;
+    // memory goes to whichever tables are hot instead of a fixed pool per table
+    return initSharedBufferPool(budget, RS_ARC, NULL);
 }
 
 // NAME: shutdownRecordManager
 // PURPOSE: shuts down the record manager, frees the recordmanager pointer
 // PARAMS: 
 // - NONE
-// RETURN VAL: RC_OK
+// RETURN VAL: RC_OK, RC_BUFFER_POOL_IN_USE
 extern RC shutdownRecordManager (){ 
 
     // free record manager pointer
     rm = NULL; 
     free(rm);
 
-    // return success
-    return RC_OK;
+    // release the shared buffer pool, every table has to be closed
+    return shutdownSharedBufferPool();
 }
 
 // NAME: find_slot
@@ -122,13 +137,9 @@ bool create_table_info_page(char *name, Schema *schema){
     rm_schema = schema;
 
     // initialize record manager attributes
-    rm->buffer_pool_capacity = 50; 
     rm->num_tuples = 0; 
     rm->first_free_page = 1;  
 
-	// Initalizing the Buffer Pool using FIFO page replacement policy
-	initBufferPool(&rm->bm_handle, name, rm->buffer_pool_capacity, RS_FIFO, NULL);
-		
 	// create new page file with name from name parameter
 	if((rc_return = createPageFile(name)) != RC_OK)
 		return false;
@@ -145,6 +156,18 @@ bool create_table_info_page(char *name, Schema *schema){
 	else if((rc_return = closePageFile(&fh)) != RC_OK)
 		return false;
 
+	// Attaching the table to the shared Buffer Pool, the pool keeps the
+	// page file open so it has to exist first
+	else if((rc_return = openSharedBufferPool(&rm->bm_handle, name)) != RC_OK)
+		return false;
+
+	// write dirty pages back while the table is in use, so inserts rarely
+	// evict a dirty page and closing the table has little left to flush
+	else if((rc_return = startBackgroundWriter(&rm->bm_handle, RM_DIRTY_PERCENT)) != RC_OK){
+		shutdownBufferPool(&rm->bm_handle);
+		return false;
+	}
+
     // if file operations worked as expected, return true. 
     else
         return true; 
@@ -181,9 +204,23 @@ extern RC createTable (char *name, Schema *schema){
 // PARAMS: 
 // - rel: table data struct
 // - name: name of the page file associated with rel
-// RETURN VAL: RC_OK
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_BUFFER_POOL_NOT_INIT, RC_ASYNC_INIT_FAILED
 extern RC openTable (RM_TableData *rel, char *name)
 {
+    // locals
+    RC rc_return;
+
+    // a table closed before is attached to the shared Buffer Pool again
+    if(rm->bm_handle.mgmtData == NULL){
+        if((rc_return = openSharedBufferPool(&rm->bm_handle, name)) != RC_OK){
+            return rc_return;
+        }
+        if((rc_return = startBackgroundWriter(&rm->bm_handle, RM_DIRTY_PERCENT)) != RC_OK){
+            shutdownBufferPool(&rm->bm_handle);
+            return rc_return;
+        }
+    }
+
 	// point table data to the record manager struct
 	rel->mgmtData = rm;
 
@@ -201,15 +238,13 @@ extern RC openTable (RM_TableData *rel, char *name)
 // but also closes the page file associated with the buffer pool
 // PARAMS: 
 // - rel: table data struct
-// RETURN VAL: RC_OK
+// RETURN VAL: RC_OK, RC_WRITE_FAILED, RC_PAGE_NOT_FOUND
 extern RC closeTable (RM_TableData *rel)
 {
 
     // shut down buffer pool
 	Record_Manager *rm = rel->mgmtData;
-	shutdownBufferPool(&rm->bm_handle);
-
-    return RC_OK; 
+	return shutdownBufferPool(&rm->bm_handle);
 }
 
 // NAME: deleteTable
@@ -458,7 +493,7 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record)
 // - rel: table data struct
 // - scan: bookkeeping for scans
 // - cond: value of the scan expression
-// RETURN VAL: RC_OK
+// RETURN VAL: RC_OK, RC_OUT_OF_MEMORY
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 {
     // locals
@@ -467,7 +502,6 @@ extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
     sm = (Record_Manager*) malloc(sizeof(Record_Manager));
 
     // initialize scan data
-    scan->mgmtData = sm;
     sm->rid.page = 1;       // start scan from page 1
 	sm->rid.slot = 0;  	    // start scan from slot 0
 	sm->num_scanned = 0;    // 0 num scanned
@@ -476,6 +510,16 @@ extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
     tm->num_tuples = rm->num_tuples; // set num tuples to the number of tuples in the record manager
     scan->rel= rel;
 
+    // pages the scan reads replace each other instead of the working set
+    if(initScanRing(&tm->bm_handle, &sm->ring, SCAN_RING_FRAMES) != RC_OK){
+        free(sm);
+        return RC_OUT_OF_MEMORY;
+    }
+
+    // the handle only owns the scan data once it is complete, so closeScan
+    // never frees it after a failed start
+    scan->mgmtData = sm;
+
     // return success
 	return RC_OK;
 }
@@ -530,8 +574,9 @@ extern RC next (RM_ScanHandle *scan, Record *record)
 			}
 		}
 
-        // pin the page of the found in scan
-        if((rc_return = pinPage(&tm->bm_handle, &sm->page_handle, sm->rid.page)) != RC_OK){
+        // pin the page of the found in scan, a miss reads the following
+        // pages into the scan's ring as well
+        if((rc_return = pinPageScan(&tm->bm_handle, &sm->ring, &sm->page_handle, sm->rid.page)) != RC_OK){
             return RC_WRITE_FAILED;
         }
 			
@@ -569,6 +614,11 @@ extern RC next (RM_ScanHandle *scan, Record *record)
 			// return success if page functions worked as expected			
 			return RC_OK;
 		}
+
+		// condition not met, release the page before moving on
+		if((rc_return = unpinPage(&tm->bm_handle, &sm->page_handle)) != RC_OK){
+			return RC_WRITE_FAILED;
+		}
     }
 	
 	// reset values if we exit scan loop
@@ -595,6 +645,9 @@ extern RC closeScan (RM_ScanHandle *scan)
     sm->num_scanned = 0;
     sm->rid.page = 1;
     sm->rid.slot = 0;
+
+    // release the ring, its pages stay in the pool
+    closeScanRing(&sm->ring);
 	
     // free the scan pointer
     free(scan->mgmtData);  
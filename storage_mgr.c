@@ -1,179 +1,714 @@
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
 #include "storage_mgr.h"
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/syscall.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-SM_FileHandle File_Handle; 
-SM_PageHandle Page_Handle; 
+// io_uring is used for asynchronous requests when the kernel headers provide
+// it, build with -DSM_NO_IO_URING to always use the worker thread fallback
+#if defined(__NR_io_uring_setup) && !defined(SM_NO_IO_URING) && __has_include(<linux/io_uring.h>)
+#define SM_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+// number of worker threads serving asynchronous requests without io_uring
+#define AIO_WORKERS 4
+
+// bounds of a single extent preallocation when a page file grows
+#define PREALLOC_MIN_PAGES 16
+#define PREALLOC_MAX_PAGES 16384
+
+// NAME: SM_FileInfo
+// PURPOSE: per-handle bookkeeping stored in SM_FileHandle->mgmtInfo. Every open
+// page file owns its own descriptor so several files can be open at once, and
+// pages are moved with positional pread/pwrite instead of fseek + fread/fwrite,
+// or copied in and out of a shared mapping of the file in SM_MODE_MMAP.
+// SM_MODE_DIRECT descriptors are opened with O_DIRECT and need page buffers
+// aligned to PAGE_ALIGNMENT, unaligned buffers go through a bounce page.
+typedef struct SM_FileInfo {
+    int fd;             // descriptor of the open page file
+    SM_FileMode mode;   // access mode the file was opened with
+    int allocated_pages; // end of the preallocated extents, may exceed totalNumPages
+    char *map;          // start of the file mapping in SM_MODE_MMAP
+    size_t map_size;    // number of mapped bytes in SM_MODE_MMAP
+} SM_FileInfo;
+
+// mode used by openPageFile for newly opened files
+static SM_FileMode page_file_mode = SM_MODE_PREAD;
+
+// NAME: page_offset
+// PURPOSE: calculate the byte offset of a page within the page file
+// PARAMS:
+// - pageNum: page to locate
+// RETURN VAL: byte offset of the page
+static off_t page_offset (int pageNum) {
+    return (off_t) pageNum * PAGE_SIZE;
+}
 
-// NAME: initStorageManager
-// PURPOSE: initialize disk handle variables
-// PARAMS: none
+// NAME: file_info
+// PURPOSE: retrieve the bookkeeping data of an open file handle
+// PARAMS:
+// - fHandle - file handle for memory
+// RETURN VAL: file info or NULL if the handle was never opened
+static SM_FileInfo *file_info (SM_FileHandle *fHandle) {
+    if (fHandle == NULL){
+        return NULL;
+    }
+    return (SM_FileInfo *) fHandle->mgmtInfo;
+}
+
+// NAME: page_aligned
+// PURPOSE: check whether a page buffer can be used for direct I/O as is
+// PARAMS:
+// - memPage: page buffer to check
+// RETURN VAL: 1 if aligned to PAGE_ALIGNMENT, 0 otherwise
+static int page_aligned (const void *memPage) {
+    return ((uintptr_t) memPage % PAGE_ALIGNMENT) == 0;
+}
+
+// NAME: alloc_aligned
+// PURPOSE: allocate a buffer aligned to PAGE_ALIGNMENT, release it with free
+// PARAMS:
+// - size: number of bytes to allocate
+// RETURN VAL: new buffer or NULL
+static SM_PageHandle alloc_aligned (size_t size) {
+
+    void *buffer;
+
+    if (posix_memalign(&buffer, PAGE_ALIGNMENT, size) != 0){
+        return NULL;
+    }
+    return (SM_PageHandle) buffer;
+}
+
+// NAME: read_page
+// PURPOSE: copy one page of an open file into memory. Callers have already
+// checked that the page exists.
+// PARAMS:
+// - info: bookkeeping of the open page file
+// - pageNum: page to read
+// - memPage: page handle to store read data into memory
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE
+static RC read_page (SM_FileInfo *info, int pageNum, SM_PageHandle memPage) {
+
+    // locals
+    SM_PageHandle bounce;
+    RC rc_return;
+
+    // mapped file, copy the page out of the mapping
+    if (info->mode == SM_MODE_MMAP){
+        memcpy(memPage, info->map + page_offset(pageNum), PAGE_SIZE);
+        return RC_OK;
+    }
+
+    // direct I/O can not land in an unaligned buffer, read through a bounce page
+    if (info->mode == SM_MODE_DIRECT && !page_aligned(memPage)){
+        if ((bounce = alloc_aligned(PAGE_SIZE)) == NULL){
+            return RC_READ_NON_EXISTING_PAGE;
+        }
+        if ((rc_return = read_page(info, pageNum, bounce)) == RC_OK){
+            memcpy(memPage, bounce, PAGE_SIZE);
+        }
+        free(bounce);
+        return rc_return;
+    }
+
+    // read the page straight from its offset, no seek required
+    if (pread(info->fd, memPage, PAGE_SIZE, page_offset(pageNum)) != PAGE_SIZE){
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    return RC_OK;
+}
+
+// NAME: write_page
+// PURPOSE: copy one page from memory into an open file. Callers have already
+// checked that the page exists.
+// PARAMS:
+// - info: bookkeeping of the open page file
+// - pageNum: page to write
+// - memPage: page handle holding the data to write
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC write_page (SM_FileInfo *info, int pageNum, SM_PageHandle memPage) {
+
+    // locals
+    SM_PageHandle bounce;
+    RC rc_return;
+
+    // mapped file, copy the page into the mapping
+    if (info->mode == SM_MODE_MMAP){
+        memcpy(info->map + page_offset(pageNum), memPage, PAGE_SIZE);
+        return RC_OK;
+    }
+
+    // direct I/O can not leave from an unaligned buffer, write through a bounce page
+    if (info->mode == SM_MODE_DIRECT && !page_aligned(memPage)){
+        if ((bounce = alloc_aligned(PAGE_SIZE)) == NULL){
+            return RC_WRITE_FAILED;
+        }
+        memcpy(bounce, memPage, PAGE_SIZE);
+        rc_return = write_page(info, pageNum, bounce);
+        free(bounce);
+        return rc_return;
+    }
+
+    // write the page straight to its offset, no seek required
+    if (pwrite(info->fd, memPage, PAGE_SIZE, page_offset(pageNum)) != PAGE_SIZE){
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// NAME: transfer_pages
+// PURPOSE: move 'numPages' consecutive pages between the file and the
+// scattered page buffers in 'memPages' with preadv/pwritev. Batches are split
+// at IOV_MAX entries and short transfers are resumed where they stopped.
+// PARAMS:
+// - info: bookkeeping of the open page file
+// - startPage: first page of the run
+// - numPages: number of pages in the run
+// - memPages: one page buffer per page of the run
+// - is_write: 1 to write the buffers to the file, 0 to read into them
+// RETURN VAL: number of bytes moved or -1 on failure
+static ssize_t transfer_pages (SM_FileInfo *info, int startPage, int numPages,
+                                SM_PageHandle *memPages, int is_write) {
+
+    // locals
+    struct iovec iov[numPages < IOV_MAX ? numPages : IOV_MAX];
+    int done_pages = 0;
+    int batch;
+    ssize_t moved;
+    ssize_t rest;
+    off_t offset;
+    RC rc_return;
+    int aligned = 1;
+
+    // direct I/O needs every buffer aligned, otherwise move the pages one by one
+    for (int i = 0; info->mode == SM_MODE_DIRECT && i < numPages; i++){
+        aligned = aligned && page_aligned(memPages[i]);
+    }
+    if (!aligned){
+        for (int i = 0; i < numPages; i++){
+            if (is_write){
+                rc_return = write_page(info, startPage + i, memPages[i]);
+            }
+            else{
+                rc_return = read_page(info, startPage + i, memPages[i]);
+            }
+            if (rc_return != RC_OK){
+                return -1;
+            }
+        }
+        return page_offset(numPages);
+    }
+
+    while (done_pages < numPages){
+
+        // describe the next batch of page buffers
+        batch = numPages - done_pages;
+        if (batch > IOV_MAX){
+            batch = IOV_MAX;
+        }
+        for (int i = 0; i < batch; i++){
+            iov[i].iov_base = memPages[done_pages + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+
+        // move the whole batch with one syscall
+        offset = page_offset(startPage + done_pages);
+        if (is_write){
+            moved = pwritev(info->fd, iov, batch, offset);
+        }
+        else{
+            moved = preadv(info->fd, iov, batch, offset);
+        }
+        if (moved <= 0){
+            return -1;
+        }
+        done_pages += moved / PAGE_SIZE;
+
+        // finish a page that was only partially moved
+        rest = moved % PAGE_SIZE;
+        while (rest != 0 && rest < PAGE_SIZE){
+            offset = page_offset(startPage + done_pages) + rest;
+            if (is_write){
+                moved = pwrite(info->fd, memPages[done_pages] + rest, PAGE_SIZE - rest, offset);
+            }
+            else{
+                moved = pread(info->fd, memPages[done_pages] + rest, PAGE_SIZE - rest, offset);
+            }
+            if (moved <= 0){
+                return -1;
+            }
+            rest += moved;
+        }
+        if (rest != 0){
+            done_pages++;
+        }
+    }
+
+    return page_offset(numPages);
+}
+
+// NAME: preallocate_pages
+// PURPOSE: reserve disk extents for pages beyond the logical end of the file.
+// Extents grow geometrically, doubling the preallocated area up to
+// PREALLOC_MAX_PAGES at a time, and are reserved with FALLOC_FL_KEEP_SIZE so
+// the file size keeps describing the logical number of pages. A jump far past
+// the preallocated area leaves the skipped pages sparse and only reserves
+// extents after the new end. File systems without fallocate simply get a
+// sparse file.
+// PARAMS:
+// - info: bookkeeping of the open page file
+// - numberOfPages: number of pages the file is growing to
 // RETURN VAL: none
-void initStorageManager (void) {
+static void preallocate_pages (SM_FileInfo *info, int numberOfPages) {
 
-    // clear all handle data
-    File_Handle.fileName = ""; 
-    File_Handle.totalNumPages = 0;
-    File_Handle.curPagePos = 0;
-    File_Handle.mgmtInfo = NULL;
+    // locals
+    int chunk = info->allocated_pages;
+
+    if (numberOfPages <= info->allocated_pages){
+        return;
+    }
+
+    // double the preallocated area, within the chunk limits
+    if (chunk < PREALLOC_MIN_PAGES){
+        chunk = PREALLOC_MIN_PAGES;
+    }
+    if (chunk > PREALLOC_MAX_PAGES){
+        chunk = PREALLOC_MAX_PAGES;
+    }
 
+    // the file jumps past the next chunk, skipped pages stay sparse
+    if (numberOfPages - info->allocated_pages > chunk){
+        info->allocated_pages = numberOfPages;
+    }
+
+    if (fallocate(info->fd, FALLOC_FL_KEEP_SIZE, page_offset(info->allocated_pages),
+                    page_offset(chunk)) == 0){
+        info->allocated_pages += chunk;
+    }
 }
 
-// NAME: createPageFile
-// PURPOSE: creates new binary file
-// PARAMS: 
+// NAME: grow_file
+// PURPOSE: extend an open page file with empty pages up to 'numberOfPages'.
+// The new pages are backed by preallocated extents and made part of the file
+// with ftruncate, so growing never writes zero pages. Mapped files also get
+// their mapping remapped to the new size.
+// PARAMS:
+// - info: bookkeeping of the open page file
+// - fHandle - file handle for memory
+// - numberOfPages: total number of pages the file must hold
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC grow_file (SM_FileInfo *info, SM_FileHandle *fHandle, int numberOfPages) {
+
+    // locals
+    off_t new_size = page_offset(numberOfPages);
+    struct stat file_stat;
+    char *new_map;
+
+    // reserve the extents ahead of the logical end of file
+    preallocate_pages(info, numberOfPages);
+
+    // ftruncate zero fills the new pages without writing them. Another handle
+    // may have grown the file further already, it must never shrink.
+    if (fstat(info->fd, &file_stat) != 0
+            || (file_stat.st_size < new_size && ftruncate(info->fd, new_size) != 0)){
+        return RC_WRITE_FAILED;
+    }
+
+    if (info->mode == SM_MODE_MMAP){
+
+        // grow the existing mapping, it may move in memory
+        if (info->map == NULL){
+            new_map = mmap(NULL, (size_t) new_size, PROT_READ | PROT_WRITE, MAP_SHARED, info->fd, 0);
+        }
+        else{
+            new_map = mremap(info->map, info->map_size, (size_t) new_size, MREMAP_MAYMOVE);
+        }
+        if (new_map == MAP_FAILED){
+            return RC_WRITE_FAILED;
+        }
+        info->map = new_map;
+        info->map_size = (size_t) new_size;
+    }
+
+    // increase total page count to that we added
+    fHandle->totalNumPages = numberOfPages;
+    return RC_OK;
+}
+
+// NAME: posix_create
+// PURPOSE: create a page file on disk holding one empty page
+// PARAMS:
 // fileName - file to be created
-// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
-RC createPageFile (char *fileName) {
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_WRITE_FAILED
+static RC posix_create (char *fileName) {
+
+    // locals
+    int fd;
+    RC rc_return = RC_OK;
 
     // Create file
-    File_Handle.mgmtInfo = fopen (fileName, "wb");
+    fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    // file could not be created
+    if (fd < 0){
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // add the first empty page
+    if (ftruncate(fd, PAGE_SIZE) != 0){
+        rc_return = RC_WRITE_FAILED;
+    }
+
+    //cleanup
+    close(fd);
+    return rc_return;
+}
+
+// NAME: posix_open
+// PURPOSE: open a page file on disk in the current page file mode
+// PARAMS:
+// fileName - file to be opened
+// fHandle - file handle for memory
+// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
+static RC posix_open (char *fileName, SM_FileHandle *fHandle) {
+
+    // locals
+    SM_FileInfo *info;
+    struct stat file_stat;
+    SM_FileMode mode;
+    int fd;
+
+    // open file, direct mode bypasses the OS page cache
+    mode = page_file_mode;
+    fd = open(fileName, O_RDWR | (mode == SM_MODE_DIRECT ? O_DIRECT : 0));
+
+    // the file system does not support direct I/O, use positional I/O instead
+    if (fd < 0 && mode == SM_MODE_DIRECT && errno == EINVAL){
+        mode = SM_MODE_PREAD;
+        fd = open(fileName, O_RDWR);
+    }
+
+    // file not found
+    if (fd < 0){
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // retrieve file size to calculate the number of pages
+    if (fstat(fd, &file_stat) != 0){
+        close(fd);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // allocate this handle's bookkeeping
+    info = (SM_FileInfo *) malloc(sizeof(SM_FileInfo));
+    info->fd = fd;
+    info->mode = mode;
+    info->allocated_pages = (int) (file_stat.st_size / PAGE_SIZE);
+    info->map = NULL;
+    info->map_size = 0;
+
+    // map the whole file, pages are then copied in and out of the mapping
+    if (info->mode == SM_MODE_MMAP && file_stat.st_size > 0){
+        info->map = mmap(NULL, (size_t) file_stat.st_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+        if (info->map == MAP_FAILED){
+            free(info);
+            close(fd);
+            return RC_FILE_NOT_FOUND;
+        }
+        info->map_size = (size_t) file_stat.st_size;
+    }
+
+    fHandle->totalNumPages = (int) (file_stat.st_size / PAGE_SIZE);
+    fHandle->mgmtInfo = info;
+
+    return RC_OK;
+}
 
-    // if file was created successfully, fill rest of struct
-    if (File_Handle.mgmtInfo != NULL) {
+// NAME: posix_close
+// PURPOSE: unmap and close a page file on disk
+// PARAMS:
+// fHandle - file handle for memory
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND
+static RC posix_close (SM_FileHandle *fHandle) {
 
-        // allocate empty buffer of size 'Page_Size'
-        Page_Handle = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
+    // locals
+    SM_FileInfo *info = file_info(fHandle);
+    int closed;
 
-        // write the empty page
-        fwrite(Page_Handle, sizeof(char), PAGE_SIZE, File_Handle.mgmtInfo);
+    // unmap the file, the kernel writes the mapped pages back
+    if (info->map != NULL){
+        munmap(info->map, info->map_size);
+    }
 
-        int seek;
-        seek = fseek(File_Handle.mgmtInfo, 0, SEEK_END);
+    // close the file and release the handle's bookkeeping
+    closed = close(info->fd);
+    free(info);
+    fHandle->mgmtInfo = NULL;
+
+    if (closed != 0){
+      return RC_FILE_NOT_FOUND;
+    }
+    return RC_OK;
+}
 
-        // set the file handle data
-        File_Handle.fileName = fileName;
-        File_Handle.curPagePos = 0;  
-        File_Handle.totalNumPages = 1;
+// NAME: posix_destroy
+// PURPOSE: delete a page file from disk
+// PARAMS:
+// fileName - file to be deleted
+// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
+static RC posix_destroy (char *fileName) {
 
-        //cleanup
-        free(Page_Handle);
-        fclose(File_Handle.mgmtInfo);
+    // Attempt to delete the file, handles that are still open keep
+    // their descriptor valid until they are closed
+    if (unlink(fileName) == 0) {
         return RC_OK;
     }
-    // file not found
-    else{
+    // file doesn't exist
+    else {
         return RC_FILE_NOT_FOUND;
     }
 }
 
+// NAME: posix_read_pages
+// PURPOSE: read consecutive pages of a page file on disk, a run of several
+// pages is moved with a single vectored read
+// PARAMS:
+// - fHandle - file handle for memory
+// - startPage: first page of the run
+// - numPages: number of pages to read
+// - memPages - one page handle per page to store the read data into memory
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE
+static RC posix_read_pages (SM_FileHandle *fHandle, int startPage, int numPages,
+                            SM_PageHandle *memPages) {
+
+    // locals
+    SM_FileInfo *info = file_info(fHandle);
+
+    // a single page or a mapped file, no vector needed
+    if (numPages == 1 || info->mode == SM_MODE_MMAP){
+        for (int i = 0; i < numPages; i++){
+            if (read_page(info, startPage + i, memPages[i]) != RC_OK){
+                return RC_READ_NON_EXISTING_PAGE;
+            }
+        }
+        return RC_OK;
+    }
+
+    if (transfer_pages(info, startPage, numPages, memPages, 0) != page_offset(numPages)){
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    return RC_OK;
+}
+
+// NAME: posix_write_pages
+// PURPOSE: write consecutive pages of a page file on disk, a run of several
+// pages is moved with a single vectored write
+// PARAMS:
+// - fHandle - file handle for memory
+// - startPage: first page of the run
+// - numPages: number of pages to write
+// - memPages - one page handle per page holding the data to write
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC posix_write_pages (SM_FileHandle *fHandle, int startPage, int numPages,
+                                SM_PageHandle *memPages) {
+
+    // locals
+    SM_FileInfo *info = file_info(fHandle);
+
+    // a single page or a mapped file, no vector needed
+    if (numPages == 1 || info->mode == SM_MODE_MMAP){
+        for (int i = 0; i < numPages; i++){
+            if (write_page(info, startPage + i, memPages[i]) != RC_OK){
+                return RC_WRITE_FAILED;
+            }
+        }
+        return RC_OK;
+    }
+
+    if (transfer_pages(info, startPage, numPages, memPages, 1) != page_offset(numPages)){
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// NAME: posix_grow
+// PURPOSE: extend a page file on disk with empty pages
+// PARAMS:
+// - fHandle - file handle for memory
+// - numberOfPages: total number of pages the file must hold
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC posix_grow (SM_FileHandle *fHandle, int numberOfPages) {
+    return grow_file(file_info(fHandle), fHandle, numberOfPages);
+}
+
+// page files on disk
+const SM_Backend SM_PosixBackend = {
+    "posix",
+    posix_create,
+    posix_open,
+    posix_close,
+    posix_destroy,
+    posix_read_pages,
+    posix_write_pages,
+    posix_grow
+};
+
+// backend used by createPageFile, openPageFile and destroyPageFile
+static const SM_Backend *storage_backend = &SM_PosixBackend;
+
+// NAME: handle_open
+// PURPOSE: check whether a file handle refers to an open page file
+// PARAMS:
+// - fHandle - file handle for memory
+// RETURN VAL: 1 if the handle is open, 0 otherwise
+static int handle_open (SM_FileHandle *fHandle) {
+    return fHandle != NULL && fHandle->mgmtInfo != NULL && fHandle->backend != NULL;
+}
+
+// NAME: initStorageManager
+// PURPOSE: initialize the storage manager. All file state lives in the
+// individual file handles, so only the default backend and access mode are
+// reset.
+// PARAMS: none
+// RETURN VAL: none
+void initStorageManager (void) {
+    storage_backend = &SM_PosixBackend;
+    page_file_mode = SM_MODE_PREAD;
+}
+
+// NAME: setPageFileMode
+// PURPOSE: select how page files on disk opened from now on are accessed.
+// Files that are already open keep the mode they were opened with.
+// PARAMS:
+// - mode: SM_MODE_PREAD, SM_MODE_MMAP or SM_MODE_DIRECT
+// RETURN VAL: none
+void setPageFileMode (SM_FileMode mode) {
+    page_file_mode = mode;
+}
+
+// NAME: getPageFileMode
+// PURPOSE: retrieve the mode used for newly opened page files
+// PARAMS: none
+// RETURN VAL: current page file mode
+SM_FileMode getPageFileMode (void) {
+    return page_file_mode;
+}
+
+// NAME: setStorageBackend
+// PURPOSE: select the backend page files are created, opened and destroyed
+// in from now on. Open handles keep using the backend they were opened from.
+// PARAMS:
+// - backend: &SM_PosixBackend, &SM_MemoryBackend or a custom backend
+// RETURN VAL: none
+void setStorageBackend (const SM_Backend *backend) {
+    storage_backend = backend;
+}
+
+// NAME: getStorageBackend
+// PURPOSE: retrieve the backend used for new page files
+// PARAMS: none
+// RETURN VAL: current storage backend
+const SM_Backend *getStorageBackend (void) {
+    return storage_backend;
+}
+
+// NAME: createPageFile
+// PURPOSE: creates new page file
+// PARAMS:
+// fileName - file to be created
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_WRITE_FAILED
+RC createPageFile (char *fileName) {
+    return storage_backend->createFile(fileName);
+}
+
 // NAME: openPageFile
 // PURPOSE: opens specified file
-// PARAMS: 
+// PARAMS:
 // fileName - file to be created
 // fHandle - file handle for memory
 // RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
 RC openPageFile (char *fileName, SM_FileHandle *fHandle) {
 
-    // open file
-    File_Handle.mgmtInfo = fopen (fileName, "rb+");
-
-    // check if file was opened correctly
-    if (File_Handle.mgmtInfo != NULL) {
+    // locals
+    RC rc_return;
 
-        // set the parameter to File_Handle data
-        fHandle->fileName = File_Handle.fileName;
-        fHandle->curPagePos = File_Handle.curPagePos;
-        fHandle->totalNumPages = File_Handle.totalNumPages;
-        fHandle->mgmtInfo = File_Handle.mgmtInfo;
-
-        return RC_OK; 
+    if ((rc_return = storage_backend->openFile(fileName, fHandle)) != RC_OK){
+        return rc_return;
     }
 
-    // file not found
-    else{
-        return RC_FILE_NOT_FOUND;
-    }
+    // set the file handle data
+    fHandle->fileName = fileName;
+    fHandle->curPagePos = 0;
+    fHandle->backend = storage_backend;
+
+    return RC_OK;
 }
 
 // NAME: closePageFile
 // PURPOSE: close the currently opened file
 // fHandle - file handle for memory
-// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_FILE_HANDLE_NOT_INIT
 RC closePageFile (SM_FileHandle *fHandle) {
 
-    // close the file
-    if(fclose(File_Handle.mgmtInfo) != 0){
-      return RC_FILE_NOT_FOUND;
-    }
-    else{
-        return RC_OK; 
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-
+    return fHandle->backend->closeFile(fHandle);
 }
 
 // NAME: destroyPageFile
-// PURPOSE: delete file from disk
-// PARAMS: 
+// PURPOSE: delete file
+// PARAMS:
 // fileName - file to be deleted
 // RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
 RC destroyPageFile (char *fileName) {
-
-    // close page file before removing
-    closePageFile(File_Handle.mgmtInfo);
-
-    // Attempt to delete the file
-    if (remove(fileName) == 0) {
-        // printf("File Deleted!\n");
-        return RC_OK;
-    } 
-    // file doesn't exist
-    else {
-        // printf("File not found Deleted!\n");
-        return RC_FILE_NOT_FOUND;
-    } 
+    return storage_backend->destroyFile(fileName);
 }
 
 // NAME: readBlock
 // PURPOSE: read data from specified page
-// PARAMS: 
-// - pageNum: denotes which page to read 
+// PARAMS:
+// - pageNum: denotes which page to read
 // data from, note - this file is 0 indexed
-// so the user must pass in n-1 pages 
+// so the user must pass in n-1 pages
 // ie. to read page 1, pass in 0
 // for 5, pass in 4 etc
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
 RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    
+
     // define local vars
-    int offset = pageNum * PAGE_SIZE; //calculate which byte to start on for writing
-    int seek; 
-    int read; 
-    
-    if (pageNum + 1 > File_Handle.totalNumPages || pageNum < 0){
+    RC rc_return;
+
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages){
         return RC_READ_NON_EXISTING_PAGE;
     }
-    else{
-        // move pointer to offset calculation
-        seek = fseek(File_Handle.mgmtInfo, offset, SEEK_SET);
-        if (seek == 0){
-
-            // read data from offset position
-            read = fread(memPage, sizeof(char), PAGE_SIZE, File_Handle.mgmtInfo);
-
-            // printf("mempage %ld\n", memPage);
-
-            // check that fread read all elements in the page
-            if (read == PAGE_SIZE){
-                File_Handle.curPagePos = pageNum;
-                fHandle->curPagePos = File_Handle.curPagePos;
-                return RC_OK;
-            }
 
-            // page doesn't exist
-            else{
-                return RC_READ_NON_EXISTING_PAGE; 
-            }
-        }
-        // seek fail
-        else{
-            return RC_SEEK_FAIL;
-        }
+    if ((rc_return = fHandle->backend->readPages(fHandle, pageNum, 1, &memPage)) != RC_OK){
+        return rc_return;
     }
+
+    fHandle->curPagePos = pageNum;
+    return RC_OK;
 }
 
 // NAME: getBlockPos
@@ -183,295 +718,800 @@ RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
 // - fHandle - file handle for memory
 // RETURN VAL: current page position
 int getBlockPos (SM_FileHandle *fHandle){
-    return File_Handle.curPagePos;
+    return fHandle->curPagePos;
 }
 
 // NAME: readFirstBlock
 // PURPOSE: read data from first page
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
 RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-
-    // define local vars
-    int seek; 
-    int read; 
-
-    // move pointer to beginning of file
-    seek = fseek(File_Handle.mgmtInfo, 0, SEEK_SET);
-
-    if (seek == 0){
-
-        // read data from beginning of the file till the end of the 
-        // page
-        read = fread(memPage, sizeof(char), PAGE_SIZE, File_Handle.mgmtInfo);
-
-        // check that fread read all elements in the page
-        if (read == PAGE_SIZE){
-            return RC_OK;
-        }
-        else{
-            return RC_READ_NON_EXISTING_PAGE; 
-        }
-    }
-    // could not move pointer to desired location
-    else{
-        return RC_SEEK_FAIL; 
-    }
+    return readBlock(0, fHandle, memPage);
 }
 
 // NAME: readPreviousBlock
 // PURPOSE: read data from previous page relative to the current
 // page position
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
 RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
 
-    // define local vars
-    int pageNum = File_Handle.curPagePos - 1;
-    
-    // check that page number is within range
-    if (pageNum > File_Handle.totalNumPages || pageNum < 0){
-        return RC_READ_NON_EXISTING_PAGE;
-    }
-    else{
-        // call read block with previous page position
-        return readBlock(pageNum, fHandle, memPage);
-    }
+    // call read block with previous page position
+    return readBlock(fHandle->curPagePos - 1, fHandle, memPage);
 }
 
 // NAME: readCurrentBlock
 // PURPOSE: read data from current page position
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
 RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
 
-    // define local vars
-    int pageNum = File_Handle.curPagePos;
-    
-    // check that page number is within range
-    if (pageNum > File_Handle.totalNumPages || pageNum < 0){
-        return RC_READ_NON_EXISTING_PAGE;
-    }
-    else{
-        // call read block with current file position
-        return readBlock(pageNum, fHandle, memPage);
-    }
-    
+    // call read block with current file position
+    return readBlock(fHandle->curPagePos, fHandle, memPage);
 }
 
 // NAME: readNextBlock
-// PURPOSE: read data from next page relative to 
+// PURPOSE: read data from next page relative to
 // current page position
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
 RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
 
-    // define local vars
-    int pageNum = File_Handle.curPagePos + 1;
-    
-    if (pageNum > File_Handle.totalNumPages || pageNum < 0){
-        return RC_READ_NON_EXISTING_PAGE;
-    }
-    else{
-        // call read block with pageNum equal to 
-        // the next page
-        return readBlock(pageNum, fHandle, memPage);
-    }
+    // call read block with pageNum equal to
+    // the next page
+    return readBlock(fHandle->curPagePos + 1, fHandle, memPage);
 }
 
 // NAME: readLastBlock
 // PURPOSE: read data from last page of the file
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
 RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
-        // define local vars
-    int seek; 
-    int read; 
 
-    // move pointer to beginning of file
-    seek = fseek(File_Handle.mgmtInfo, (-PAGE_SIZE), SEEK_END);
+    // call read block with the last page of the file
+    return readBlock(fHandle->totalNumPages - 1, fHandle, memPage);
+}
 
-    // valid seek
-    if (seek == 0){
+// NAME: readBlocks
+// PURPOSE: read 'numPages' consecutive pages starting at 'startPage' with a
+// single vectored read
+// PARAMS:
+// - startPage: first page of the run
+// - numPages: number of pages to read
+// - fHandle - file handle for memory
+// - memPages - one page handle per page to store the read data into memory
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_FILE_HANDLE_NOT_INIT
+RC readBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
 
-        // read data from beginning of the file till the end of the 
-        // page
-        read = fread(memPage, sizeof(char), PAGE_SIZE, File_Handle.mgmtInfo);
+    // define local vars
+    RC rc_return;
 
-        // check that fread read all elements in the page
-        if (read == PAGE_SIZE){
-            return RC_OK;
-        }
-        // return error
-        else{
-            return RC_READ_NON_EXISTING_PAGE; 
-        }
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-    // could not move pointer to desired location
-    else{
-        return RC_SEEK_FAIL; 
+    if (startPage < 0 || numPages < 1 || numPages > fHandle->totalNumPages - startPage){
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+
+    if ((rc_return = fHandle->backend->readPages(fHandle, startPage, numPages, memPages)) != RC_OK){
+        return rc_return;
     }
+
+    fHandle->curPagePos = startPage + numPages - 1;
+    return RC_OK;
 }
 
 // NAME: writeBlock
 // PURPOSE: write data to a specified page
-// PARAMS: 
-// - pageNum: denotes which page to write 
+// PARAMS:
+// - pageNum: denotes which page to write
 // data to, note - this file is 0 indexed
-// so the user must pass in n-1 pages 
+// so the user must pass in n-1 pages
 // ie. to read page 1, pass in 0
 // for 5, pass in 4 etc
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_WRITE_FAILED, RC_FILE_HANDLE_NOT_INIT
 RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    
-    // define local vars
-    int offset = pageNum * PAGE_SIZE; //calculate which byte to start on for writing
-    int seek; 
-    int write_elems;   
+
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
 
     // ensure page number is within range
-    if(pageNum + 1 > File_Handle.totalNumPages){
-        return RC_PAGE_NOT_FOUND; 
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages){
+        return RC_PAGE_NOT_FOUND;
     }
-    else{
 
-        // move pointer to the offset
-        seek = fseek(File_Handle.mgmtInfo, offset, SEEK_SET);
+    return fHandle->backend->writePages(fHandle, pageNum, 1, &memPage);
+}
 
-        // valid seek
-        if (seek == 0){
-            write_elems = fwrite(memPage, sizeof(char), PAGE_SIZE, File_Handle.mgmtInfo);
-            return RC_OK; 
-        }
-        // could not move pointer to desired location
-        else{
-            return RC_SEEK_FAIL;
-        }
+// NAME: writeBlocks
+// PURPOSE: write 'numPages' consecutive pages starting at 'startPage' with a
+// single vectored write
+// PARAMS:
+// - startPage: first page of the run
+// - numPages: number of pages to write
+// - fHandle - file handle for memory
+// - memPages - one page handle per page holding the data to write
+// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_WRITE_FAILED, RC_FILE_HANDLE_NOT_INIT
+RC writeBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages) {
+
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
     }
+
+    // ensure the whole run is within range
+    if (startPage < 0 || numPages < 1 || numPages > fHandle->totalNumPages - startPage){
+        return RC_PAGE_NOT_FOUND;
+    }
+
+    return fHandle->backend->writePages(fHandle, startPage, numPages, memPages);
 }
 
 // NAME: writeCurrentBlock
 // PURPOSE: write data to the current page position
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
 // - memPage - page handle to store read data into memory
-// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_WRITE_FAILED, RC_FILE_HANDLE_NOT_INIT
 RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage) {
 
-    // define local vars
-    int pageNum = File_Handle.curPagePos; 
-    
     // call write function with pageNum equal to current position
-    return writeBlock(pageNum, fHandle, memPage);
-
+    return writeBlock(fHandle->curPagePos, fHandle, memPage);
 }
 
 // NAME: appendEmptyBlock
 // PURPOSE: add an empty block of data of PAGE_SIZE to the
 // end of the file
-// PARAMS: 
+// PARAMS:
 // - fHandle - file handle for memory
-// RETURN VAL: RC_OK, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_WRITE_FAILED, RC_FILE_HANDLE_NOT_INIT
 RC appendEmptyBlock (SM_FileHandle *fHandle) {
-    int seek; 
-    int write_elems; 
-
-    // allocate empty buffer of size 'Page_Size'
-    Page_Handle = (SM_PageHandle) calloc(PAGE_SIZE, sizeof(char));
-
-    // move pointer to end of file
-    seek = fseek(File_Handle.mgmtInfo, 0, SEEK_END);
-
-    // valid seek
-    if (seek == 0){
 
-        // write the empty page
-        write_elems = fwrite(Page_Handle, sizeof(char), PAGE_SIZE, File_Handle.mgmtInfo);
-
-        // printf("WRITE elements from append: %i", write_elems);
-
-        File_Handle.totalNumPages = File_Handle.totalNumPages + 1; 
-        fHandle->totalNumPages = File_Handle.totalNumPages; 
-    }
-    // could not move pointer to desired location
-    else{
-        return RC_SEEK_FAIL; 
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-    
-    // clear buffer
-    free(Page_Handle);
 
-    // return okay if error hasn't been raised
-    return RC_OK;
+    // add the empty page after the last page
+    return fHandle->backend->growFile(fHandle, fHandle->totalNumPages + 1);
 }
 
 // NAME: ensureCapacity
 // PURPOSE: ensure the file contains enough pages
-// based on input paramenter 'numberOfPages', 
+// based on input paramenter 'numberOfPages',
 // if not, increase the files capacity to support
 // the page amount
-// PARAMS: 
+// PARAMS:
 // - numberOfPages: specifies the number of pages
 // the user is checking capacity for
 // - fHandle - file handle for memory
-// RETURN VAL: RC_OK, RC_SEEK_FAIL
+// RETURN VAL: RC_OK, RC_WRITE_FAILED, RC_FILE_HANDLE_NOT_INIT
 RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle) {
 
-    //define locals
-    int pages_needed; 
-    int buffer_size;
-    int seek;
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
 
-    // check if the current capacity can support the 
+    // check if the current capacity can support the
     // user's request
-    if (numberOfPages <= File_Handle.totalNumPages){
+    if (numberOfPages <= fHandle->totalNumPages){
         return RC_OK;
     }
-    // create desired pages
+
+    // add all missing pages after the last page
+    return fHandle->backend->growFile(fHandle, numberOfPages);
+}
+
+/************************************************************
+ *                asynchronous page requests                *
+ ************************************************************/
+
+// NAME: SM_AsyncSlot
+// PURPOSE: one submitted request. The slot stays in use until the caller
+// reaps its completion.
+typedef struct SM_AsyncSlot {
+    int in_use;
+    int is_write;
+    int pageNum;
+    SM_FileHandle file;     // copy of the submitting handle
+    SM_PageHandle memPage;
+    void *userData;
+    struct iovec iov;
+    RC rc;
+} SM_AsyncSlot;
+
+// NAME: SM_AsyncInfo
+// PURPOSE: bookkeeping stored in SM_AsyncQueue->mgmtInfo. Requests on page
+// files on disk go to an io_uring instance when the kernel supports it,
+// otherwise a small pool of worker threads performs them through the file's
+// backend. In both cases the lock guards the slots, the slot lists and the
+// rings, so several threads may submit to and reap from one queue.
+typedef struct SM_AsyncInfo {
+    SM_AsyncSlot *slots;
+    int use_uring;
+
+    // slots finished without going through the ring or the workers
+    int *done;
+    int done_head;
+    int done_count;
+
+#ifdef SM_HAVE_IO_URING
+    // io_uring instance and its shared rings
+    int ring_fd;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    int uring_waiting;      // a reaper waits in io_uring_enter, only it drains
+#endif
+
+    // worker thread fallback
+    pthread_t workers[AIO_WORKERS];
+    int num_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    int *pending;
+    int pending_head;
+    int pending_count;
+    int stopping;
+} SM_AsyncInfo;
+
+// NAME: execute_request
+// PURPOSE: perform a request synchronously
+// PARAMS:
+// - slot: request to perform
+// RETURN VAL: none, the result is stored in the slot
+static void execute_request (SM_AsyncSlot *slot) {
+    if (slot->is_write){
+        slot->rc = slot->file.backend->writePages(&slot->file, slot->pageNum, 1, &slot->memPage);
+    }
     else{
+        slot->rc = slot->file.backend->readPages(&slot->file, slot->pageNum, 1, &slot->memPage);
+    }
+}
 
-        // move pointer to end of file
-        seek = fseek(File_Handle.mgmtInfo, 0, SEEK_END);
+// NAME: push_slot
+// PURPOSE: append a slot index to one of the circular slot lists
+// PARAMS:
+// - list: circular list with queueDepth entries
+// - head, count: position and length of the list
+// - depth: capacity of the list
+// - index: slot index to append
+// RETURN VAL: none
+static void push_slot (int *list, int head, int *count, int depth, int index) {
+    list[(head + *count) % depth] = index;
+    (*count)++;
+}
 
-        // valid seek
-        if (seek == 0){
+// NAME: pop_slot
+// PURPOSE: remove the oldest slot index from one of the circular slot lists
+// PARAMS:
+// - list: circular list with queueDepth entries
+// - head, count: position and length of the list
+// - depth: capacity of the list
+// RETURN VAL: slot index
+static int pop_slot (int *list, int *head, int *count, int depth) {
+    int index = list[*head];
+    *head = (*head + 1) % depth;
+    (*count)--;
+    return index;
+}
 
-            // calculate number of pages to write
-            pages_needed = numberOfPages - File_Handle.totalNumPages; 
+// NAME: async_worker
+// PURPOSE: worker thread of the fallback engine. Takes pending requests in
+// submission order, performs them and queues them as done.
+// PARAMS:
+// - arg: SM_AsyncQueue the worker belongs to
+// RETURN VAL: NULL
+static void *async_worker (void *arg) {
 
-            // calculate number of bytes in buffer
-            buffer_size = pages_needed * PAGE_SIZE;
+    SM_AsyncQueue *queue = (SM_AsyncQueue *) arg;
+    SM_AsyncInfo *aio = (SM_AsyncInfo *) queue->mgmtInfo;
+    int index;
 
-            // allocate buffer space of for buffer elements
-            Page_Handle = (SM_PageHandle) calloc(buffer_size, sizeof(char));
+    pthread_mutex_lock(&aio->lock);
+    while (1){
 
-            // write the empty page
-            int n = fwrite(Page_Handle, sizeof(char), buffer_size, File_Handle.mgmtInfo);
+        // sleep until there is work or the queue shuts down
+        while (aio->pending_count == 0 && !aio->stopping){
+            pthread_cond_wait(&aio->work_ready, &aio->lock);
+        }
+        if (aio->pending_count == 0){
+            break;
+        }
+        index = pop_slot(aio->pending, &aio->pending_head, &aio->pending_count, queue->queueDepth);
+
+        // perform the request without holding the lock
+        pthread_mutex_unlock(&aio->lock);
+        execute_request(&aio->slots[index]);
+        pthread_mutex_lock(&aio->lock);
+
+        push_slot(aio->done, aio->done_head, &aio->done_count, queue->queueDepth, index);
+        pthread_cond_broadcast(&aio->work_done);
+    }
+    pthread_mutex_unlock(&aio->lock);
 
-            // increase total page count to that we added
-            File_Handle.totalNumPages += pages_needed; 
-            fHandle->totalNumPages = File_Handle.totalNumPages; 
+    return NULL;
+}
 
-            // clear buffer
-            free(Page_Handle);
-            
-            return RC_OK; 
+#ifdef SM_HAVE_IO_URING
+// NAME: setup_uring
+// PURPOSE: create an io_uring instance and map its submission and completion
+// rings
+// PARAMS:
+// - aio: bookkeeping of the queue
+// - queueDepth: number of entries the rings must hold
+// RETURN VAL: 1 on success, 0 when io_uring is not available
+static int setup_uring (SM_AsyncInfo *aio, int queueDepth) {
+
+    struct io_uring_params params;
+    char *sq_ring;
+    char *cq_ring;
+
+    memset(&params, 0, sizeof(params));
+    aio->ring_fd = (int) syscall(__NR_io_uring_setup, queueDepth, &params);
+    if (aio->ring_fd < 0){
+        return 0;
+    }
+
+    // map the rings, newer kernels share a single mapping for both
+    aio->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    aio->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP){
+        if (aio->cq_ring_size > aio->sq_ring_size){
+            aio->sq_ring_size = aio->cq_ring_size;
+        }
+        aio->cq_ring_size = 0;
+    }
+    aio->sq_ring = mmap(NULL, aio->sq_ring_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, aio->ring_fd, IORING_OFF_SQ_RING);
+    if (aio->sq_ring == MAP_FAILED){
+        close(aio->ring_fd);
+        return 0;
+    }
+    aio->cq_ring = aio->sq_ring;
+    if (aio->cq_ring_size != 0){
+        aio->cq_ring = mmap(NULL, aio->cq_ring_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, aio->ring_fd, IORING_OFF_CQ_RING);
+        if (aio->cq_ring == MAP_FAILED){
+            munmap(aio->sq_ring, aio->sq_ring_size);
+            close(aio->ring_fd);
+            return 0;
+        }
+    }
+    aio->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    aio->sqes = mmap(NULL, aio->sqes_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, aio->ring_fd, IORING_OFF_SQES);
+    if (aio->sqes == MAP_FAILED){
+        if (aio->cq_ring_size != 0){
+            munmap(aio->cq_ring, aio->cq_ring_size);
+        }
+        munmap(aio->sq_ring, aio->sq_ring_size);
+        close(aio->ring_fd);
+        return 0;
+    }
+
+    // locate the ring fields inside the mappings
+    sq_ring = (char *) aio->sq_ring;
+    cq_ring = (char *) aio->cq_ring;
+    aio->sq_head = (unsigned *) (sq_ring + params.sq_off.head);
+    aio->sq_tail = (unsigned *) (sq_ring + params.sq_off.tail);
+    aio->sq_mask = (unsigned *) (sq_ring + params.sq_off.ring_mask);
+    aio->sq_array = (unsigned *) (sq_ring + params.sq_off.array);
+    aio->cq_head = (unsigned *) (cq_ring + params.cq_off.head);
+    aio->cq_tail = (unsigned *) (cq_ring + params.cq_off.tail);
+    aio->cq_mask = (unsigned *) (cq_ring + params.cq_off.ring_mask);
+    aio->cqes = (struct io_uring_cqe *) (cq_ring + params.cq_off.cqes);
+
+    return 1;
+}
+
+// NAME: teardown_uring
+// PURPOSE: unmap the rings and close the io_uring instance
+// PARAMS:
+// - aio: bookkeeping of the queue
+// RETURN VAL: none
+static void teardown_uring (SM_AsyncInfo *aio) {
+    munmap(aio->sqes, aio->sqes_size);
+    if (aio->cq_ring_size != 0){
+        munmap(aio->cq_ring, aio->cq_ring_size);
+    }
+    munmap(aio->sq_ring, aio->sq_ring_size);
+    close(aio->ring_fd);
+}
+
+// NAME: uring_capable
+// PURPOSE: check whether a request can be handed to the kernel as is
+// PARAMS:
+// - slot: request to check
+// RETURN VAL: 1 if the request reads or writes a descriptor directly
+static int uring_capable (SM_AsyncSlot *slot) {
+
+    SM_FileInfo *info;
+
+    if (slot->file.backend != &SM_PosixBackend){
+        return 0;
+    }
+    info = file_info(&slot->file);
+    if (info->mode == SM_MODE_MMAP){
+        return 0;
+    }
+    return info->mode != SM_MODE_DIRECT || page_aligned(slot->memPage);
+}
+
+// NAME: submit_uring
+// PURPOSE: place a request on the submission ring and hand it to the kernel.
+// Once the kernel consumed the entry the request completes through the
+// completion ring, even if io_uring_enter reported an error. An entry the
+// kernel did not consume is taken off the ring again, so the caller can run
+// the request itself without it ever running twice.
+// PARAMS:
+// - aio: bookkeeping of the queue
+// - index: slot of the request
+// RETURN VAL: RC_OK, RC_WRITE_FAILED if the request was not submitted
+static RC submit_uring (SM_AsyncInfo *aio, int index) {
+
+    SM_AsyncSlot *slot = &aio->slots[index];
+    unsigned tail = *aio->sq_tail;
+    unsigned ring_index = tail & *aio->sq_mask;
+    struct io_uring_sqe *sqe = &aio->sqes[ring_index];
+    int submitted;
+
+    slot->iov.iov_base = slot->memPage;
+    slot->iov.iov_len = PAGE_SIZE;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = slot->is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = file_info(&slot->file)->fd;
+    sqe->addr = (unsigned long) &slot->iov;
+    sqe->len = 1;
+    sqe->off = (unsigned long long) page_offset(slot->pageNum);
+    sqe->user_data = (unsigned long long) index;
+    aio->sq_array[ring_index] = ring_index;
+
+    // publish the entry before the kernel looks at the tail
+    __atomic_store_n(aio->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    do {
+        submitted = (int) syscall(__NR_io_uring_enter, aio->ring_fd, 1, 0, 0, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+
+    // the kernel only reads the ring during io_uring_enter, an entry it left
+    // behind is still ours to withdraw
+    if (submitted != 1 && __atomic_load_n(aio->sq_head, __ATOMIC_ACQUIRE) == tail){
+        __atomic_store_n(aio->sq_tail, tail, __ATOMIC_RELEASE);
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// NAME: drain_uring
+// PURPOSE: move every completion the kernel posted into the done list
+// PARAMS:
+// - queue: queue to drain
+// RETURN VAL: none
+static void drain_uring (SM_AsyncQueue *queue) {
+
+    SM_AsyncInfo *aio = (SM_AsyncInfo *) queue->mgmtInfo;
+    unsigned head = *aio->cq_head;
+    unsigned tail = __atomic_load_n(aio->cq_tail, __ATOMIC_ACQUIRE);
+    struct io_uring_cqe *cqe;
+    SM_AsyncSlot *slot;
+
+    while (head != tail){
+        cqe = &aio->cqes[head & *aio->cq_mask];
+        slot = &aio->slots[cqe->user_data];
+        if (cqe->res == PAGE_SIZE){
+            slot->rc = RC_OK;
         }
-        // could not move pointer to desired location
         else{
-            return RC_SEEK_FAIL;
+            slot->rc = slot->is_write ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        }
+        push_slot(aio->done, aio->done_head, &aio->done_count, queue->queueDepth, (int) cqe->user_data);
+        head++;
+    }
+    __atomic_store_n(aio->cq_head, head, __ATOMIC_RELEASE);
+}
+#endif
+
+// NAME: initAsyncQueue
+// PURPOSE: initialize a queue for asynchronous page requests
+// PARAMS:
+// - queue: queue to initialize
+// - queueDepth: maximum number of requests in flight
+// RETURN VAL: RC_OK, RC_ASYNC_INIT_FAILED
+RC initAsyncQueue (SM_AsyncQueue *queue, int queueDepth) {
+
+    SM_AsyncInfo *aio = (SM_AsyncInfo *) calloc(1, sizeof(SM_AsyncInfo));
+
+    if (aio == NULL || queueDepth < 1){
+        free(aio);
+        return RC_ASYNC_INIT_FAILED;
+    }
+
+    aio->slots = (SM_AsyncSlot *) calloc(queueDepth, sizeof(SM_AsyncSlot));
+    aio->done = (int *) malloc(sizeof(int) * queueDepth);
+    aio->pending = (int *) malloc(sizeof(int) * queueDepth);
+    pthread_mutex_init(&aio->lock, NULL);
+    pthread_cond_init(&aio->work_ready, NULL);
+    pthread_cond_init(&aio->work_done, NULL);
+
+    queue->queueDepth = queueDepth;
+    queue->numInFlight = 0;
+    queue->mgmtInfo = aio;
+
+#ifdef SM_HAVE_IO_URING
+    aio->use_uring = setup_uring(aio, queueDepth);
+#endif
+
+    // no io_uring, start the worker threads instead
+    if (!aio->use_uring){
+        for (aio->num_workers = 0; aio->num_workers < AIO_WORKERS; aio->num_workers++){
+            if (pthread_create(&aio->workers[aio->num_workers], NULL, async_worker, queue) != 0){
+                break;
+            }
+        }
+        if (aio->num_workers == 0){
+            shutdownAsyncQueue(queue);
+            return RC_ASYNC_INIT_FAILED;
+        }
+    }
+
+    return RC_OK;
+}
+
+// NAME: shutdownAsyncQueue
+// PURPOSE: wait for all requests in flight and release the queue. Completions
+// that were not reaped are dropped.
+// PARAMS:
+// - queue: queue to shut down
+// RETURN VAL: RC_OK, RC_FILE_HANDLE_NOT_INIT
+RC shutdownAsyncQueue (SM_AsyncQueue *queue) {
+
+    SM_AsyncInfo *aio = (SM_AsyncInfo *) queue->mgmtInfo;
+    SM_Completion completion;
+
+    if (aio == NULL){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    // finish everything that is still in flight
+    while (queue->numInFlight > 0){
+        reapCompletions(queue, &completion, 1, 1);
+    }
+
+#ifdef SM_HAVE_IO_URING
+    if (aio->use_uring){
+        teardown_uring(aio);
+    }
+#endif
+
+    // stop the worker threads
+    pthread_mutex_lock(&aio->lock);
+    aio->stopping = 1;
+    pthread_cond_broadcast(&aio->work_ready);
+    pthread_mutex_unlock(&aio->lock);
+    for (int i = 0; i < aio->num_workers; i++){
+        pthread_join(aio->workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&aio->lock);
+    pthread_cond_destroy(&aio->work_ready);
+    pthread_cond_destroy(&aio->work_done);
+    free(aio->slots);
+    free(aio->done);
+    free(aio->pending);
+    free(aio);
+    queue->mgmtInfo = NULL;
+
+    return RC_OK;
+}
+
+// NAME: submit_request
+// PURPOSE: claim a slot for a request and hand it to the engine
+// PARAMS:
+// - queue: queue to submit to
+// - is_write: 1 for a write, 0 for a read
+// - pageNum, fHandle, memPage, userData: the request
+// RETURN VAL: RC_OK, RC_ASYNC_QUEUE_FULL, RC_FILE_HANDLE_NOT_INIT
+static RC submit_request (SM_AsyncQueue *queue, int is_write, int pageNum,
+                            SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData) {
+
+    SM_AsyncInfo *aio = (SM_AsyncInfo *) queue->mgmtInfo;
+    SM_AsyncSlot *slot = NULL;
+    int index;
+
+    if (aio == NULL){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+    pthread_mutex_lock(&aio->lock);
+    if (queue->numInFlight == queue->queueDepth){
+        pthread_mutex_unlock(&aio->lock);
+        return RC_ASYNC_QUEUE_FULL;
+    }
+
+    // claim a free slot
+    for (index = 0; index < queue->queueDepth; index++){
+        if (!aio->slots[index].in_use){
+            slot = &aio->slots[index];
+            break;
+        }
+    }
+    slot->in_use = 1;
+    slot->is_write = is_write;
+    slot->pageNum = pageNum;
+    slot->file = *fHandle;
+    slot->memPage = memPage;
+    slot->userData = userData;
+    queue->numInFlight++;
+
+#ifdef SM_HAVE_IO_URING
+    if (aio->use_uring){
+
+        // only descriptors go through the ring, other backends and mapped
+        // pages are a memcpy and unaligned direct buffers need the bounce page
+        // of the synchronous path. Such a request finishes under the lock, so
+        // a reaper never waits in the kernel for a request that is not there.
+        if (!uring_capable(slot) || submit_uring(aio, index) != RC_OK){
+            execute_request(slot);
+            push_slot(aio->done, aio->done_head, &aio->done_count, queue->queueDepth, index);
+        }
+        pthread_mutex_unlock(&aio->lock);
+        return RC_OK;
+    }
+#endif
+
+    // hand the request to the worker threads
+    push_slot(aio->pending, aio->pending_head, &aio->pending_count, queue->queueDepth, index);
+    pthread_cond_signal(&aio->work_ready);
+    pthread_mutex_unlock(&aio->lock);
+
+    return RC_OK;
+}
+
+// NAME: submitReadBlock
+// PURPOSE: start reading a page into memory without waiting for it. memPage
+// must stay valid until the completion is reaped.
+// PARAMS:
+// - queue: queue to submit to
+// - pageNum: page to read
+// - fHandle - file handle for memory
+// - memPage - page handle to store read data into memory
+// - userData - returned with the completion
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE, RC_ASYNC_QUEUE_FULL, RC_FILE_HANDLE_NOT_INIT
+RC submitReadBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle,
+                    SM_PageHandle memPage, void *userData) {
+
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages){
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    return submit_request(queue, 0, pageNum, fHandle, memPage, userData);
+}
+
+// NAME: submitWriteBlock
+// PURPOSE: start writing a page to disk without waiting for it. memPage
+// must stay valid and unchanged until the completion is reaped.
+// PARAMS:
+// - queue: queue to submit to
+// - pageNum: page to write
+// - fHandle - file handle for memory
+// - memPage - page handle holding the data to write
+// - userData - returned with the completion
+// RETURN VAL: RC_OK, RC_PAGE_NOT_FOUND, RC_ASYNC_QUEUE_FULL, RC_FILE_HANDLE_NOT_INIT
+RC submitWriteBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle,
+                        SM_PageHandle memPage, void *userData) {
+
+    if (!handle_open(fHandle)){
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (pageNum < 0 || pageNum >= fHandle->totalNumPages){
+        return RC_PAGE_NOT_FOUND;
+    }
+    return submit_request(queue, 1, pageNum, fHandle, memPage, userData);
+}
+
+// NAME: reapCompletions
+// PURPOSE: collect finished requests. Waits until at least 'minCompletions'
+// requests finished, or until nothing is left in flight.
+// PARAMS:
+// - queue: queue to reap from
+// - completions: array receiving the finished requests
+// - maxCompletions: capacity of 'completions'
+// - minCompletions: number of completions to wait for, 0 to only poll
+// RETURN VAL: number of completions stored in 'completions'
+int reapCompletions (SM_AsyncQueue *queue, SM_Completion *completions,
+                        int maxCompletions, int minCompletions) {
+
+    SM_AsyncInfo *aio = (SM_AsyncInfo *) queue->mgmtInfo;
+    SM_AsyncSlot *slot;
+    int num_reaped = 0;
+    int index;
+
+    if (aio == NULL){
+        return 0;
+    }
+
+    pthread_mutex_lock(&aio->lock);
+    if (minCompletions > queue->numInFlight){
+        minCompletions = queue->numInFlight;
+    }
+    if (minCompletions > maxCompletions){
+        minCompletions = maxCompletions;
+    }
+
+    while (num_reaped < maxCompletions){
+
+        // pick up what the kernel finished since the last call, unless another
+        // reaper is waiting in the kernel for it
+#ifdef SM_HAVE_IO_URING
+        if (aio->use_uring && !aio->uring_waiting){
+            drain_uring(queue);
         }
+#endif
+
+        if (aio->done_count == 0){
+
+            // enough collected, or nothing to wait for, another thread may
+            // have reaped what was in flight
+            if (num_reaped >= minCompletions || queue->numInFlight == 0){
+                break;
+            }
+
+            // block until another request finishes. One reaper waits in the
+            // kernel without the lock, the others wait for it to come back.
+#ifdef SM_HAVE_IO_URING
+            if (aio->use_uring && !aio->uring_waiting){
+                aio->uring_waiting = 1;
+                pthread_mutex_unlock(&aio->lock);
+                syscall(__NR_io_uring_enter, aio->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+                pthread_mutex_lock(&aio->lock);
+                aio->uring_waiting = 0;
+                pthread_cond_broadcast(&aio->work_done);
+                continue;
+            }
+#endif
+            pthread_cond_wait(&aio->work_done, &aio->lock);
+            continue;
+        }
+
+        // hand the finished request to the caller and free its slot
+        index = pop_slot(aio->done, &aio->done_head, &aio->done_count, queue->queueDepth);
+        slot = &aio->slots[index];
+        completions[num_reaped].pageNum = slot->pageNum;
+        completions[num_reaped].rc = slot->rc;
+        completions[num_reaped].userData = slot->userData;
+        slot->in_use = 0;
+        queue->numInFlight--;
+        num_reaped++;
     }
+
+    pthread_mutex_unlock(&aio->lock);
+
+    return num_reaped;
 }
\ No newline at end of file
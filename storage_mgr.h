@@ -6,20 +6,68 @@
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
+struct SM_Backend;
+
 typedef struct SM_FileHandle {
 	char *fileName;
 	int totalNumPages;
 	int curPagePos;
 	void *mgmtInfo;
+	const struct SM_Backend *backend;	// storage the file was opened from
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+/* operations of a storage backend. The interface functions below check the
+ * handle and page ranges and keep curPagePos before calling into these, so a
+ * backend only moves pages. openFile sets mgmtInfo and totalNumPages. */
+typedef struct SM_Backend {
+	const char *name;
+	RC (*createFile) (char *fileName);
+	RC (*openFile) (char *fileName, SM_FileHandle *fHandle);
+	RC (*closeFile) (SM_FileHandle *fHandle);
+	RC (*destroyFile) (char *fileName);
+	RC (*readPages) (SM_FileHandle *fHandle, int startPage, int numPages, SM_PageHandle *memPages);
+	RC (*writePages) (SM_FileHandle *fHandle, int startPage, int numPages, SM_PageHandle *memPages);
+	RC (*growFile) (SM_FileHandle *fHandle, int numberOfPages);
+} SM_Backend;
+
+/* page files on disk, accessed according to the page file mode */
+extern const SM_Backend SM_PosixBackend;
+/* page files kept in process memory, they never touch the file system */
+extern const SM_Backend SM_MemoryBackend;
+/* page files on disk with every page compressed, for cold tables */
+extern const SM_Backend SM_CompressedBackend;
+
+/* queue of asynchronous page requests and their completions */
+typedef struct SM_AsyncQueue {
+	int queueDepth;		// maximum number of requests in flight
+	int numInFlight;	// submitted requests that were not reaped yet
+	void *mgmtInfo;
+} SM_AsyncQueue;
+
+typedef struct SM_Completion {
+	int pageNum;
+	RC rc;			// result of the finished request
+	void *userData;		// pointer passed in when the request was submitted
+} SM_Completion;
+
+/* how an opened page file moves pages between disk and memory */
+typedef enum SM_FileMode {
+	SM_MODE_PREAD = 0,	// positional pread/pwrite per page
+	SM_MODE_MMAP = 1,	// file is memory mapped, pages are memcpy'd
+	SM_MODE_DIRECT = 2	// O_DIRECT pread/pwrite, bypasses the OS page cache
+} SM_FileMode;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
+extern void setPageFileMode (SM_FileMode mode);
+extern SM_FileMode getPageFileMode (void);
+extern void setStorageBackend (const SM_Backend *backend);
+extern const SM_Backend *getStorageBackend (void);
 extern RC createPageFile (char *fileName);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
@@ -33,11 +81,20 @@ extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int startPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
 
+/* asynchronous page requests */
+extern RC initAsyncQueue (SM_AsyncQueue *queue, int queueDepth);
+extern RC shutdownAsyncQueue (SM_AsyncQueue *queue);
+extern RC submitReadBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern RC submitWriteBlock (SM_AsyncQueue *queue, int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage, void *userData);
+extern int reapCompletions (SM_AsyncQueue *queue, SM_Completion *completions, int maxCompletions, int minCompletions);
+
 #endif
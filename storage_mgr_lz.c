@@ -0,0 +1,646 @@
+#define _FILE_OFFSET_BITS 64
+#include "storage_mgr.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// identifies a compressed page file
+#define LZ_MAGIC "SMLZ"
+
+// shortest match the codec encodes, a match is found through a hash of its
+// first LZ_MIN_MATCH bytes
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+// NAME: SM_LzHeader
+// PURPOSE: first bytes of a compressed page file. The page map is written
+// behind the last compressed page when the file is closed.
+typedef struct SM_LzHeader {
+    char magic[4];
+    int32_t numPages;   // number of pages in the file
+    int64_t mapOffset;  // byte offset of the page map
+} SM_LzHeader;
+
+// NAME: SM_LzExtent
+// PURPOSE: page map entry, where a page is stored in the file. A length of 0
+// is a page that was never written and reads back as zeros, a length of
+// PAGE_SIZE is a page that did not compress and is stored as is.
+typedef struct SM_LzExtent {
+    int64_t offset;     // byte offset of the stored page
+    int32_t length;     // number of bytes the stored page uses
+    int32_t capacity;   // number of bytes reserved for the page at 'offset'
+} SM_LzExtent;
+
+// NAME: SM_LzFile
+// PURPOSE: state of an open compressed page file, stored in
+// SM_FileHandle->mgmtInfo. Handles opening the same file share it, so the
+// page map and the end of the data area stay consistent between them.
+typedef struct SM_LzFile {
+    int fd;
+    dev_t device;           // identity of the file, to find it on open
+    ino_t inode;
+    SM_LzExtent *extents;   // page map, one entry per page
+    int numPages;           // number of pages in the file
+    int capacity;           // number of entries in 'extents'
+    off_t data_end;         // compressed pages are appended here
+    int open_handles;       // handles that currently have the file open
+    pthread_mutex_t lock;   // serializes access to the page map and the file
+    struct SM_LzFile *next;
+} SM_LzFile;
+
+// all open compressed files
+static SM_LzFile *lz_files = NULL;
+static pthread_mutex_t lz_files_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// NAME: lz_hash
+// PURPOSE: hash the LZ_MIN_MATCH bytes starting at 'src'
+// PARAMS:
+// - src: bytes to hash
+// RETURN VAL: index into the match table
+static int lz_hash (const unsigned char *src) {
+
+    uint32_t sequence;
+
+    memcpy(&sequence, src, sizeof(sequence));
+    return (int) ((sequence * 2654435761u) >> (32 - LZ_HASH_BITS));
+}
+
+// NAME: lz_put_length
+// PURPOSE: append the part of a length that does not fit into its 4 bit token
+// field, as a run of 255 bytes closed by a byte below 255
+// PARAMS:
+// - dst, pos, dst_cap: output buffer, write position and capacity
+// - length: remaining length to encode
+// RETURN VAL: 0 on success, -1 when the output buffer is full
+static int lz_put_length (unsigned char *dst, int *pos, int dst_cap, int length) {
+
+    while (length >= 255){
+        if (*pos >= dst_cap){
+            return -1;
+        }
+        dst[(*pos)++] = 255;
+        length -= 255;
+    }
+    if (*pos >= dst_cap){
+        return -1;
+    }
+    dst[(*pos)++] = (unsigned char) length;
+    return 0;
+}
+
+// NAME: lz_put_sequence
+// PURPOSE: append one sequence, a run of literals followed by a match. The
+// token byte holds the literal count in its high and the match length in its
+// low 4 bits, the value 15 means the length continues in extra bytes. The last
+// sequence of a page has no match.
+// PARAMS:
+// - dst, pos, dst_cap: output buffer, write position and capacity
+// - literals, num_literals: bytes to copy as is
+// - offset: distance back to the match, 0 for the last sequence
+// - match_length: length of the match
+// RETURN VAL: 0 on success, -1 when the output buffer is full
+static int lz_put_sequence (unsigned char *dst, int *pos, int dst_cap,
+                            const unsigned char *literals, int num_literals,
+                            int offset, int match_length) {
+
+    int match_code = offset == 0 ? 0 : match_length - LZ_MIN_MATCH;
+    int token_pos = *pos;
+
+    if (*pos >= dst_cap){
+        return -1;
+    }
+    dst[token_pos] = (unsigned char) (((num_literals < 15 ? num_literals : 15) << 4)
+                                        | (match_code < 15 ? match_code : 15));
+    (*pos)++;
+
+    // literals
+    if (num_literals >= 15 && lz_put_length(dst, pos, dst_cap, num_literals - 15) != 0){
+        return -1;
+    }
+    if (*pos + num_literals > dst_cap){
+        return -1;
+    }
+    memcpy(dst + *pos, literals, num_literals);
+    *pos += num_literals;
+
+    if (offset == 0){
+        return 0;
+    }
+
+    // match
+    if (*pos + 2 > dst_cap){
+        return -1;
+    }
+    dst[(*pos)++] = (unsigned char) (offset & 0xff);
+    dst[(*pos)++] = (unsigned char) (offset >> 8);
+    if (match_code >= 15 && lz_put_length(dst, pos, dst_cap, match_code - 15) != 0){
+        return -1;
+    }
+    return 0;
+}
+
+// NAME: lz_compress
+// PURPOSE: compress a buffer with a greedy LZ77 pass. Repeated byte runs, such
+// as padded string slots and zeroed free space, become overlapping matches.
+// PARAMS:
+// - src, src_len: bytes to compress
+// - dst, dst_cap: output buffer and its capacity
+// RETURN VAL: compressed length or -1 if it does not fit into 'dst_cap'
+static int lz_compress (const unsigned char *src, int src_len, unsigned char *dst, int dst_cap) {
+
+    // locals
+    int table[1 << LZ_HASH_BITS];
+    int ip = 0;
+    int anchor = 0;
+    int pos = 0;
+    int hash;
+    int ref;
+    int match_length;
+
+    memset(table, -1, sizeof(table));
+
+    while (ip + LZ_MIN_MATCH <= src_len){
+
+        // remember this position, and check what was there before
+        hash = lz_hash(src + ip);
+        ref = table[hash];
+        table[hash] = ip;
+
+        if (ref < 0 || ip - ref > LZ_MAX_OFFSET || memcmp(src + ref, src + ip, LZ_MIN_MATCH) != 0){
+            ip++;
+            continue;
+        }
+
+        // extend the match as far as it goes
+        match_length = LZ_MIN_MATCH;
+        while (ip + match_length < src_len && src[ref + match_length] == src[ip + match_length]){
+            match_length++;
+        }
+
+        if (lz_put_sequence(dst, &pos, dst_cap, src + anchor, ip - anchor,
+                            ip - ref, match_length) != 0){
+            return -1;
+        }
+        ip += match_length;
+        anchor = ip;
+    }
+
+    // the rest of the buffer as literals
+    if (lz_put_sequence(dst, &pos, dst_cap, src + anchor, src_len - anchor, 0, 0) != 0){
+        return -1;
+    }
+    return pos;
+}
+
+// NAME: lz_get_length
+// PURPOSE: read the extra bytes of a length written by lz_put_length
+// PARAMS:
+// - src, pos, src_len: input buffer, read position and length
+// - length: length to extend
+// RETURN VAL: 0 on success, -1 on truncated input
+static int lz_get_length (const unsigned char *src, int *pos, int src_len, int *length) {
+
+    unsigned char byte;
+
+    do {
+        if (*pos >= src_len){
+            return -1;
+        }
+        byte = src[(*pos)++];
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+// NAME: lz_decompress
+// PURPOSE: expand a buffer written by lz_compress. Every length and offset is
+// checked, so a damaged page is reported instead of overrunning 'dst'.
+// PARAMS:
+// - src, src_len: compressed bytes
+// - dst, dst_cap: output buffer and its capacity
+// RETURN VAL: decompressed length or -1 if the input is damaged
+static int lz_decompress (const unsigned char *src, int src_len, unsigned char *dst, int dst_cap) {
+
+    // locals
+    int ip = 0;
+    int op = 0;
+    int token;
+    int num_literals;
+    int match_length;
+    int offset;
+
+    while (ip < src_len){
+
+        token = src[ip++];
+
+        // literals
+        num_literals = token >> 4;
+        if (num_literals == 15 && lz_get_length(src, &ip, src_len, &num_literals) != 0){
+            return -1;
+        }
+        if (ip + num_literals > src_len || op + num_literals > dst_cap){
+            return -1;
+        }
+        memcpy(dst + op, src + ip, num_literals);
+        ip += num_literals;
+        op += num_literals;
+
+        // the last sequence ends with its literals
+        if (ip == src_len){
+            break;
+        }
+
+        // match, copied byte by byte since it may overlap its own output
+        if (ip + 2 > src_len){
+            return -1;
+        }
+        offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        match_length = token & 15;
+        if (match_length == 15 && lz_get_length(src, &ip, src_len, &match_length) != 0){
+            return -1;
+        }
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || op + match_length > dst_cap){
+            return -1;
+        }
+        for (int i = 0; i < match_length; i++, op++){
+            dst[op] = dst[op - offset];
+        }
+    }
+
+    return op;
+}
+
+// NAME: lz_reserve
+// PURPOSE: make room for 'numPages' entries in the page map of a file
+// PARAMS:
+// - file: open compressed file
+// - numPages: number of pages the map must describe
+// RETURN VAL: 0 on success, -1 when out of memory
+static int lz_reserve (SM_LzFile *file, int numPages) {
+
+    SM_LzExtent *extents;
+    int capacity = file->capacity * 2;
+
+    if (numPages <= file->capacity){
+        return 0;
+    }
+    if (capacity < numPages){
+        capacity = numPages;
+    }
+    extents = (SM_LzExtent *) realloc(file->extents, sizeof(SM_LzExtent) * capacity);
+    if (extents == NULL){
+        return -1;
+    }
+    memset(extents + file->capacity, 0, sizeof(SM_LzExtent) * (capacity - file->capacity));
+    file->extents = extents;
+    file->capacity = capacity;
+    return 0;
+}
+
+// NAME: lz_write_map
+// PURPOSE: persist the page map behind the data area and point the header at
+// it. A map left behind by an earlier close is overwritten.
+// PARAMS:
+// - file: open compressed file
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC lz_write_map (SM_LzFile *file) {
+
+    SM_LzHeader header;
+    size_t map_size = sizeof(SM_LzExtent) * file->numPages;
+
+    memcpy(header.magic, LZ_MAGIC, sizeof(header.magic));
+    header.numPages = file->numPages;
+    header.mapOffset = file->data_end;
+
+    if (pwrite(file->fd, file->extents, map_size, file->data_end) != (ssize_t) map_size
+            || ftruncate(file->fd, file->data_end + (off_t) map_size) != 0
+            || pwrite(file->fd, &header, sizeof(header), 0) != sizeof(header)){
+        return RC_WRITE_FAILED;
+    }
+    return RC_OK;
+}
+
+// NAME: lz_create
+// PURPOSE: create a compressed page file holding one empty page
+// PARAMS:
+// fileName - file to be created
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_WRITE_FAILED
+static RC lz_create (char *fileName) {
+
+    // locals
+    SM_LzFile file;
+    SM_LzExtent empty_page;
+    RC rc_return;
+
+    memset(&file, 0, sizeof(file));
+    memset(&empty_page, 0, sizeof(empty_page));
+
+    file.fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file.fd < 0){
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // a header and a map with one page that was never written
+    file.extents = &empty_page;
+    file.numPages = 1;
+    file.data_end = sizeof(SM_LzHeader);
+    rc_return = lz_write_map(&file);
+
+    close(file.fd);
+    return rc_return;
+}
+
+// NAME: lz_load
+// PURPOSE: read the header and page map of a compressed file. Every page must
+// lie inside the data area and fit into a page buffer.
+// PARAMS:
+// - file: file to load, its descriptor is open
+// - size: size of the file in bytes
+// RETURN VAL: RC_OK, RC_BAD_FILE_FORMAT
+static RC lz_load (SM_LzFile *file, off_t size) {
+
+    SM_LzHeader header;
+    SM_LzExtent *extent;
+    size_t map_size;
+
+    if (pread(file->fd, &header, sizeof(header), 0) != sizeof(header)
+            || memcmp(header.magic, LZ_MAGIC, sizeof(header.magic)) != 0
+            || header.numPages < 0 || header.mapOffset < (int64_t) sizeof(header)){
+        return RC_BAD_FILE_FORMAT;
+    }
+
+    map_size = sizeof(SM_LzExtent) * header.numPages;
+    if (header.mapOffset + (off_t) map_size > size || lz_reserve(file, header.numPages) != 0
+            || pread(file->fd, file->extents, map_size, header.mapOffset) != (ssize_t) map_size){
+        return RC_BAD_FILE_FORMAT;
+    }
+
+    for (int i = 0; i < header.numPages; i++){
+        extent = &file->extents[i];
+        if (extent->length < 0 || extent->length > extent->capacity || extent->capacity > PAGE_SIZE
+                || (extent->capacity > 0 && (extent->offset < (int64_t) sizeof(header)
+                                             || extent->offset + extent->capacity > header.mapOffset))){
+            return RC_BAD_FILE_FORMAT;
+        }
+    }
+
+    // new pages go where the map is, it is written again on close
+    file->numPages = header.numPages;
+    file->data_end = header.mapOffset;
+    return RC_OK;
+}
+
+// NAME: lz_open
+// PURPOSE: open a compressed page file. A file that is already open is shared
+// with the handles that opened it before.
+// PARAMS:
+// fileName - file to be opened
+// fHandle - file handle for memory
+// RETURN VAL: RC_OK, RC_FILE_NOT_FOUND, RC_BAD_FILE_FORMAT
+static RC lz_open (char *fileName, SM_FileHandle *fHandle) {
+
+    // locals
+    SM_LzFile *file;
+    struct stat file_stat;
+    RC rc_return;
+    int fd;
+
+    if ((fd = open(fileName, O_RDWR)) < 0){
+        return RC_FILE_NOT_FOUND;
+    }
+    if (fstat(fd, &file_stat) != 0){
+        close(fd);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&lz_files_lock);
+
+    // share the state of a file that is already open
+    for (file = lz_files; file != NULL; file = file->next){
+        if (file->device == file_stat.st_dev && file->inode == file_stat.st_ino){
+            break;
+        }
+    }
+    if (file != NULL){
+        close(fd);
+    }
+    else{
+        file = (SM_LzFile *) calloc(1, sizeof(SM_LzFile));
+        file->fd = fd;
+        file->device = file_stat.st_dev;
+        file->inode = file_stat.st_ino;
+        if ((rc_return = lz_load(file, file_stat.st_size)) != RC_OK){
+            pthread_mutex_unlock(&lz_files_lock);
+            close(fd);
+            free(file->extents);
+            free(file);
+            return rc_return;
+        }
+        pthread_mutex_init(&file->lock, NULL);
+        file->next = lz_files;
+        lz_files = file;
+    }
+    file->open_handles++;
+
+    pthread_mutex_lock(&file->lock);
+    fHandle->totalNumPages = file->numPages;
+    pthread_mutex_unlock(&file->lock);
+    fHandle->mgmtInfo = file;
+
+    pthread_mutex_unlock(&lz_files_lock);
+    return RC_OK;
+}
+
+// NAME: lz_close
+// PURPOSE: close a compressed page file. The last handle persists the page
+// map and releases the shared state.
+// PARAMS:
+// fHandle - file handle for memory
+// RETURN VAL: RC_OK, RC_WRITE_FAILED, RC_FILE_NOT_FOUND
+static RC lz_close (SM_FileHandle *fHandle) {
+
+    SM_LzFile *file = (SM_LzFile *) fHandle->mgmtInfo;
+    SM_LzFile **link;
+    RC rc_return = RC_OK;
+
+    pthread_mutex_lock(&lz_files_lock);
+
+    if (--file->open_handles == 0){
+
+        // unregister the file
+        link = &lz_files;
+        while (*link != file){
+            link = &(*link)->next;
+        }
+        *link = file->next;
+
+        rc_return = lz_write_map(file);
+        if (close(file->fd) != 0 && rc_return == RC_OK){
+            rc_return = RC_FILE_NOT_FOUND;
+        }
+        pthread_mutex_destroy(&file->lock);
+        free(file->extents);
+        free(file);
+    }
+
+    pthread_mutex_unlock(&lz_files_lock);
+
+    fHandle->mgmtInfo = NULL;
+    return rc_return;
+}
+
+// NAME: lz_destroy
+// PURPOSE: delete a compressed page file from disk
+// PARAMS:
+// fileName - file to be deleted
+// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
+static RC lz_destroy (char *fileName) {
+    return SM_PosixBackend.destroyFile(fileName);
+}
+
+// NAME: lz_read_pages
+// PURPOSE: read consecutive pages of a compressed file and expand them. The
+// page map locates every page, so each page costs a single read. A page that
+// is cut short or does not expand to a full page is damaged.
+// PARAMS:
+// - fHandle - file handle for memory
+// - startPage: first page of the run
+// - numPages: number of pages to read
+// - memPages - one page handle per page to store the read data into memory
+// RETURN VAL: RC_OK, RC_BAD_FILE_FORMAT
+static RC lz_read_pages (SM_FileHandle *fHandle, int startPage, int numPages,
+                            SM_PageHandle *memPages) {
+
+    // locals
+    SM_LzFile *file = (SM_LzFile *) fHandle->mgmtInfo;
+    unsigned char stored[PAGE_SIZE];
+    SM_LzExtent extent;
+    RC rc_return = RC_OK;
+
+    for (int i = 0; rc_return == RC_OK && i < numPages; i++){
+
+        pthread_mutex_lock(&file->lock);
+        extent = file->extents[startPage + i];
+
+        // a page that was never written
+        if (extent.length == 0){
+            memset(memPages[i], 0, PAGE_SIZE);
+        }
+
+        // a page stored as is goes straight into the caller's buffer
+        else if (extent.length == PAGE_SIZE){
+            if (pread(file->fd, memPages[i], PAGE_SIZE, extent.offset) != PAGE_SIZE){
+                rc_return = RC_BAD_FILE_FORMAT;
+            }
+        }
+        else if (pread(file->fd, stored, extent.length, extent.offset) != extent.length){
+            rc_return = RC_BAD_FILE_FORMAT;
+        }
+        pthread_mutex_unlock(&file->lock);
+
+        // expand the page without holding the lock
+        if (rc_return == RC_OK && extent.length != 0 && extent.length != PAGE_SIZE
+                && lz_decompress(stored, extent.length, (unsigned char *) memPages[i], PAGE_SIZE) != PAGE_SIZE){
+            rc_return = RC_BAD_FILE_FORMAT;
+        }
+    }
+
+    return rc_return;
+}
+
+// NAME: lz_write_pages
+// PURPOSE: compress consecutive pages and store them. A page that still fits
+// into the space it used before is rewritten in place, otherwise it is
+// appended to the data area. Pages that do not compress are stored as is.
+// PARAMS:
+// - fHandle - file handle for memory
+// - startPage: first page of the run
+// - numPages: number of pages to write
+// - memPages - one page handle per page holding the data to write
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC lz_write_pages (SM_FileHandle *fHandle, int startPage, int numPages,
+                            SM_PageHandle *memPages) {
+
+    // locals
+    SM_LzFile *file = (SM_LzFile *) fHandle->mgmtInfo;
+    unsigned char compressed[PAGE_SIZE];
+    SM_LzExtent *extent;
+    const void *stored;
+    int length;
+    RC rc_return = RC_OK;
+
+    for (int i = 0; rc_return == RC_OK && i < numPages; i++){
+
+        // compress without holding the lock, keep the page as is if that
+        // does not save anything
+        length = lz_compress((unsigned char *) memPages[i], PAGE_SIZE, compressed, PAGE_SIZE - 1);
+        stored = compressed;
+        if (length < 0){
+            length = PAGE_SIZE;
+            stored = memPages[i];
+        }
+
+        pthread_mutex_lock(&file->lock);
+        extent = &file->extents[startPage + i];
+
+        // the page outgrew its space, move it to the end of the data area
+        if (length > extent->capacity){
+            extent->offset = file->data_end;
+            extent->capacity = length;
+            file->data_end += length;
+        }
+        extent->length = length;
+
+        if (pwrite(file->fd, stored, length, extent->offset) != length){
+            rc_return = RC_WRITE_FAILED;
+        }
+        pthread_mutex_unlock(&file->lock);
+    }
+
+    return rc_return;
+}
+
+// NAME: lz_grow
+// PURPOSE: extend a compressed file with empty pages. Only the page map grows,
+// empty pages take no space until they are written.
+// PARAMS:
+// - fHandle - file handle for memory
+// - numberOfPages: total number of pages the file must hold
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC lz_grow (SM_FileHandle *fHandle, int numberOfPages) {
+
+    SM_LzFile *file = (SM_LzFile *) fHandle->mgmtInfo;
+
+    pthread_mutex_lock(&file->lock);
+    if (lz_reserve(file, numberOfPages) != 0){
+        pthread_mutex_unlock(&file->lock);
+        return RC_WRITE_FAILED;
+    }
+    if (numberOfPages > file->numPages){
+        file->numPages = numberOfPages;
+    }
+    pthread_mutex_unlock(&file->lock);
+
+    fHandle->totalNumPages = numberOfPages;
+    return RC_OK;
+}
+
+// page files on disk with every page compressed
+const SM_Backend SM_CompressedBackend = {
+    "compressed",
+    lz_create,
+    lz_open,
+    lz_close,
+    lz_destroy,
+    lz_read_pages,
+    lz_write_pages,
+    lz_grow
+};
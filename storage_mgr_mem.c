@@ -0,0 +1,318 @@
+#include "storage_mgr.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NAME: SM_MemoryFile
+// PURPOSE: a page file kept in process memory. Files are registered by name so
+// a file created once can be opened by several handles, like a file on disk.
+// Pages that were never written are not allocated and read back as zeros.
+typedef struct SM_MemoryFile {
+    char *name;
+    SM_PageHandle *pages;   // one entry per page, NULL until the page is written
+    int numPages;           // number of pages in the file
+    int capacity;           // number of entries in 'pages'
+    int open_handles;       // handles that currently have the file open
+    int destroyed;          // file was destroyed while still open
+    pthread_mutex_t lock;   // guards the page table against concurrent growth
+    struct SM_MemoryFile *next;
+} SM_MemoryFile;
+
+// all in-memory files that were not destroyed
+static SM_MemoryFile *memory_files = NULL;
+static pthread_mutex_t memory_files_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// NAME: find_memory_file
+// PURPOSE: look up an in-memory file by name, the caller holds memory_files_lock
+// PARAMS:
+// - fileName: name of the file
+// RETURN VAL: the file or NULL if it does not exist
+static SM_MemoryFile *find_memory_file (char *fileName) {
+
+    SM_MemoryFile *file;
+
+    for (file = memory_files; file != NULL; file = file->next){
+        if (strcmp(file->name, fileName) == 0){
+            return file;
+        }
+    }
+    return NULL;
+}
+
+// NAME: truncate_memory_file
+// PURPOSE: drop every page of an in-memory file and leave one empty page
+// PARAMS:
+// - file: file to truncate
+// RETURN VAL: none
+static void truncate_memory_file (SM_MemoryFile *file) {
+
+    pthread_mutex_lock(&file->lock);
+    for (int i = 0; i < file->numPages; i++){
+        free(file->pages[i]);
+        file->pages[i] = NULL;
+    }
+    file->numPages = 1;
+    pthread_mutex_unlock(&file->lock);
+}
+
+// NAME: free_memory_file
+// PURPOSE: release an in-memory file and all of its pages
+// PARAMS:
+// - file: file to release, it is no longer registered
+// RETURN VAL: none
+static void free_memory_file (SM_MemoryFile *file) {
+
+    for (int i = 0; i < file->numPages; i++){
+        free(file->pages[i]);
+    }
+    pthread_mutex_destroy(&file->lock);
+    free(file->pages);
+    free(file->name);
+    free(file);
+}
+
+// NAME: memory_create
+// PURPOSE: create an in-memory page file holding one empty page. An existing
+// file of the same name is truncated, like O_TRUNC does on disk.
+// PARAMS:
+// fileName - file to be created
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC memory_create (char *fileName) {
+
+    SM_MemoryFile *file;
+
+    pthread_mutex_lock(&memory_files_lock);
+
+    if ((file = find_memory_file(fileName)) != NULL){
+        truncate_memory_file(file);
+        pthread_mutex_unlock(&memory_files_lock);
+        return RC_OK;
+    }
+
+    file = (SM_MemoryFile *) calloc(1, sizeof(SM_MemoryFile));
+    if (file == NULL){
+        pthread_mutex_unlock(&memory_files_lock);
+        return RC_WRITE_FAILED;
+    }
+    file->name = strdup(fileName);
+    file->capacity = 1;
+    file->pages = (SM_PageHandle *) calloc(file->capacity, sizeof(SM_PageHandle));
+    file->numPages = 1;
+    pthread_mutex_init(&file->lock, NULL);
+
+    file->next = memory_files;
+    memory_files = file;
+
+    pthread_mutex_unlock(&memory_files_lock);
+    return RC_OK;
+}
+
+// NAME: memory_open
+// PURPOSE: open an in-memory page file
+// PARAMS:
+// fileName - file to be opened
+// fHandle - file handle for memory
+// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
+static RC memory_open (char *fileName, SM_FileHandle *fHandle) {
+
+    SM_MemoryFile *file;
+
+    pthread_mutex_lock(&memory_files_lock);
+
+    if ((file = find_memory_file(fileName)) == NULL){
+        pthread_mutex_unlock(&memory_files_lock);
+        return RC_FILE_NOT_FOUND;
+    }
+    file->open_handles++;
+
+    pthread_mutex_lock(&file->lock);
+    fHandle->totalNumPages = file->numPages;
+    pthread_mutex_unlock(&file->lock);
+    fHandle->mgmtInfo = file;
+
+    pthread_mutex_unlock(&memory_files_lock);
+    return RC_OK;
+}
+
+// NAME: memory_close
+// PURPOSE: close an in-memory page file. The pages stay registered until the
+// file is destroyed.
+// PARAMS:
+// fHandle - file handle for memory
+// RETURN VAL: RC_OK
+static RC memory_close (SM_FileHandle *fHandle) {
+
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+
+    pthread_mutex_lock(&memory_files_lock);
+
+    // the last handle of a destroyed file releases it
+    file->open_handles--;
+    if (file->destroyed && file->open_handles == 0){
+        free_memory_file(file);
+    }
+
+    pthread_mutex_unlock(&memory_files_lock);
+
+    fHandle->mgmtInfo = NULL;
+    return RC_OK;
+}
+
+// NAME: memory_destroy
+// PURPOSE: delete an in-memory page file. Handles that are still open keep
+// the pages until they are closed, like an unlinked file on disk.
+// PARAMS:
+// fileName - file to be deleted
+// RETURN VAL: RC_OK or RC_FILE_NOT_FOUND
+static RC memory_destroy (char *fileName) {
+
+    SM_MemoryFile **link;
+    SM_MemoryFile *file;
+
+    pthread_mutex_lock(&memory_files_lock);
+
+    for (link = &memory_files; *link != NULL; link = &(*link)->next){
+        if (strcmp((*link)->name, fileName) == 0){
+            break;
+        }
+    }
+    if (*link == NULL){
+        pthread_mutex_unlock(&memory_files_lock);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    // unregister the file, release it once no handle uses it
+    file = *link;
+    *link = file->next;
+    if (file->open_handles == 0){
+        free_memory_file(file);
+    }
+    else{
+        file->destroyed = 1;
+    }
+
+    pthread_mutex_unlock(&memory_files_lock);
+    return RC_OK;
+}
+
+// NAME: memory_read_pages
+// PURPOSE: copy consecutive pages of an in-memory file into memory
+// PARAMS:
+// - fHandle - file handle for memory
+// - startPage: first page of the run
+// - numPages: number of pages to read
+// - memPages - one page handle per page to store the read data into memory
+// RETURN VAL: RC_OK, RC_READ_NON_EXISTING_PAGE
+static RC memory_read_pages (SM_FileHandle *fHandle, int startPage, int numPages,
+                                SM_PageHandle *memPages) {
+
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+    RC rc_return = RC_OK;
+
+    pthread_mutex_lock(&file->lock);
+
+    // the file may have been truncated through another handle
+    if (startPage + numPages > file->numPages){
+        rc_return = RC_READ_NON_EXISTING_PAGE;
+    }
+
+    for (int i = 0; rc_return == RC_OK && i < numPages; i++){
+        if (file->pages[startPage + i] == NULL){
+            memset(memPages[i], 0, PAGE_SIZE);
+        }
+        else{
+            memcpy(memPages[i], file->pages[startPage + i], PAGE_SIZE);
+        }
+    }
+
+    pthread_mutex_unlock(&file->lock);
+    return rc_return;
+}
+
+// NAME: memory_write_pages
+// PURPOSE: copy consecutive pages from memory into an in-memory file, pages
+// are allocated the first time they are written
+// PARAMS:
+// - fHandle - file handle for memory
+// - startPage: first page of the run
+// - numPages: number of pages to write
+// - memPages - one page handle per page holding the data to write
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC memory_write_pages (SM_FileHandle *fHandle, int startPage, int numPages,
+                                SM_PageHandle *memPages) {
+
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+    SM_PageHandle *page;
+    RC rc_return = RC_OK;
+
+    pthread_mutex_lock(&file->lock);
+
+    // the file may have been truncated through another handle
+    if (startPage + numPages > file->numPages){
+        rc_return = RC_WRITE_FAILED;
+    }
+
+    for (int i = 0; rc_return == RC_OK && i < numPages; i++){
+        page = &file->pages[startPage + i];
+        if (*page == NULL && (*page = (SM_PageHandle) malloc(PAGE_SIZE)) == NULL){
+            rc_return = RC_WRITE_FAILED;
+            break;
+        }
+        memcpy(*page, memPages[i], PAGE_SIZE);
+    }
+
+    pthread_mutex_unlock(&file->lock);
+    return rc_return;
+}
+
+// NAME: memory_grow
+// PURPOSE: extend an in-memory file with empty pages. Only the page table
+// grows, the pages themselves are allocated when they are written.
+// PARAMS:
+// - fHandle - file handle for memory
+// - numberOfPages: total number of pages the file must hold
+// RETURN VAL: RC_OK, RC_WRITE_FAILED
+static RC memory_grow (SM_FileHandle *fHandle, int numberOfPages) {
+
+    SM_MemoryFile *file = (SM_MemoryFile *) fHandle->mgmtInfo;
+    SM_PageHandle *pages;
+    int capacity;
+
+    pthread_mutex_lock(&file->lock);
+
+    // double the page table so repeated appends stay amortized O(1)
+    if (numberOfPages > file->capacity){
+        capacity = file->capacity * 2;
+        if (capacity < numberOfPages){
+            capacity = numberOfPages;
+        }
+        pages = (SM_PageHandle *) realloc(file->pages, sizeof(SM_PageHandle) * capacity);
+        if (pages == NULL){
+            pthread_mutex_unlock(&file->lock);
+            return RC_WRITE_FAILED;
+        }
+        memset(pages + file->capacity, 0, sizeof(SM_PageHandle) * (capacity - file->capacity));
+        file->pages = pages;
+        file->capacity = capacity;
+    }
+    if (numberOfPages > file->numPages){
+        file->numPages = numberOfPages;
+    }
+
+    pthread_mutex_unlock(&file->lock);
+
+    fHandle->totalNumPages = numberOfPages;
+    return RC_OK;
+}
+
+// page files kept in process memory
+const SM_Backend SM_MemoryBackend = {
+    "memory",
+    memory_create,
+    memory_open,
+    memory_close,
+    memory_destroy,
+    memory_read_pages,
+    memory_write_pages,
+    memory_grow
+};
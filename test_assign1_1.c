@@ -0,0 +1,393 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_pagefile.bin"
+
+/* number of pages the multi page tests write */
+#define NUM_TEST_PAGES 12
+
+/* every storage backend and page file mode the tests run in, the mode only
+ * applies to page files on disk */
+typedef struct TestConfig {
+  const SM_Backend *backend;
+  SM_FileMode mode;
+  char *name;
+} TestConfig;
+
+static TestConfig configs[] = {
+  { &SM_PosixBackend, SM_MODE_PREAD, "posix, pread" },
+  { &SM_PosixBackend, SM_MODE_MMAP, "posix, mmap" },
+  { &SM_PosixBackend, SM_MODE_DIRECT, "posix, direct" },
+  { &SM_MemoryBackend, SM_MODE_PREAD, "memory" },
+  { &SM_CompressedBackend, SM_MODE_PREAD, "compressed" }
+};
+#define NUM_CONFIGS ((int) (sizeof(configs) / sizeof(configs[0])))
+
+/* prototypes for test functions */
+static void testCreateOpenClose(void);
+static void testSinglePageContent(void);
+static void testMultiPageContent(void);
+static void testAlignedPages(void);
+static void testEnsureCapacity(void);
+
+/* helper methods */
+static void setTestName(char *name);
+static void fillPage(SM_PageHandle ph, int pageNum);
+static int pageMatches(SM_PageHandle ph, int pageNum);
+static int pageIsEmpty(SM_PageHandle ph);
+
+/* configuration the tests currently run in */
+static int currentConfig;
+
+/* main function running all tests */
+int
+main (void)
+{
+  testName = "";
+
+  initStorageManager();
+
+  for (currentConfig = 0; currentConfig < NUM_CONFIGS; currentConfig++)
+  {
+    setStorageBackend(configs[currentConfig].backend);
+    setPageFileMode(configs[currentConfig].mode);
+
+    testCreateOpenClose();
+    testSinglePageContent();
+    testMultiPageContent();
+    testAlignedPages();
+    testEnsureCapacity();
+  }
+
+  return 0;
+}
+
+
+/* Try to create, open, and close a page file */
+void
+testCreateOpenClose(void)
+{
+  SM_FileHandle fh;
+
+  setTestName("test create open and close methods");
+
+  TEST_CHECK(createPageFile (TESTPF));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_TRUE(strcmp(fh.fileName, TESTPF) == 0, "filename correct");
+  ASSERT_TRUE((fh.totalNumPages == 1), "expect 1 page in new file");
+  ASSERT_TRUE((fh.curPagePos == 0), "freshly opened file's page position should be 0");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+
+  // after destruction trying to open the file should cause an error
+  ASSERT_TRUE((openPageFile(TESTPF, &fh) != RC_OK), "opening non-existing file should return an error.");
+
+  TEST_DONE();
+}
+
+/* Try to write a single page and read it back */
+void
+testSinglePageContent(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  int i;
+
+  setTestName("test single page content");
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  // create a new page file
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+
+  // read first page into handle, the page should be empty (zero bytes)
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  ASSERT_TRUE(pageIsEmpty(ph), "expected zero bytes in first page of freshly initialized page");
+
+  // change ph to be a string and write that one to disk
+  for (i=0; i < PAGE_SIZE; i++)
+    ph[i] = (i % 10) + '0';
+  TEST_CHECK(writeBlock (0, &fh, ph));
+
+  // read back the page containing the string and check that it is correct
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  for (i=0; i < PAGE_SIZE && ph[i] == (i % 10) + '0'; i++)
+    ;
+  ASSERT_EQUALS_INT(PAGE_SIZE, i, "characters in page read from disk are the ones we expected");
+
+  // the page survives closing the file
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock (0, &fh, ph));
+  ASSERT_TRUE((ph[PAGE_SIZE - 1] == ((PAGE_SIZE - 1) % 10) + '0'), "page is still there after reopening");
+
+  // destroy new page file
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Write several pages one by one and as a run, and read them back with
+ * every read method */
+void
+testMultiPageContent(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  SM_PageHandle run[NUM_TEST_PAGES];
+  int i;
+
+  setTestName("test multi page content");
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  for (i = 0; i < NUM_TEST_PAGES; i++)
+    run[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+
+  // the first half is appended and written page by page
+  for (i = 0; i < NUM_TEST_PAGES / 2; i++)
+  {
+    if (i > 0)
+      TEST_CHECK(appendEmptyBlock (&fh));
+    fillPage(ph, i);
+    TEST_CHECK(writeBlock (i, &fh, ph));
+  }
+  ASSERT_EQUALS_INT(NUM_TEST_PAGES / 2, fh.totalNumPages, "one page per appended block");
+
+  // the second half is written as one run
+  TEST_CHECK(ensureCapacity (NUM_TEST_PAGES, &fh));
+  for (i = NUM_TEST_PAGES / 2; i < NUM_TEST_PAGES; i++)
+    fillPage(run[i - NUM_TEST_PAGES / 2], i);
+  TEST_CHECK(writeBlocks (NUM_TEST_PAGES / 2, NUM_TEST_PAGES - NUM_TEST_PAGES / 2, &fh, run));
+
+  // reopen so the page count comes from the file
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(NUM_TEST_PAGES, fh.totalNumPages, "page count after reopening");
+
+  // one run read covers every page
+  for (i = 0; i < NUM_TEST_PAGES; i++)
+    memset(run[i], 0, PAGE_SIZE);
+  TEST_CHECK(readBlocks (0, NUM_TEST_PAGES, &fh, run));
+  for (i = 0; i < NUM_TEST_PAGES && pageMatches(run[i], i); i++)
+    ;
+  ASSERT_EQUALS_INT(NUM_TEST_PAGES, i, "pages read as one run");
+
+  // walk forward and back through the file
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  for (i = 1; i < NUM_TEST_PAGES && readNextBlock(&fh, ph) == RC_OK && pageMatches(ph, i); i++)
+    ;
+  ASSERT_EQUALS_INT(NUM_TEST_PAGES, i, "pages read with readNextBlock");
+  ASSERT_ERROR(readNextBlock (&fh, ph), "reading past the last page");
+
+  TEST_CHECK(readLastBlock (&fh, ph));
+  ASSERT_TRUE(pageMatches(ph, NUM_TEST_PAGES - 1), "last page");
+  TEST_CHECK(readPreviousBlock (&fh, ph));
+  ASSERT_TRUE(pageMatches(ph, NUM_TEST_PAGES - 2), "page before the last one");
+  TEST_CHECK(readCurrentBlock (&fh, ph));
+  ASSERT_TRUE(pageMatches(ph, NUM_TEST_PAGES - 2), "current page");
+  ASSERT_EQUALS_INT(NUM_TEST_PAGES - 2, getBlockPos(&fh), "current page position");
+
+  ASSERT_ERROR(readBlock (NUM_TEST_PAGES, &fh, ph), "reading a page past the end");
+  ASSERT_ERROR(readBlock (-1, &fh, ph), "reading a negative page");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i = 0; i < NUM_TEST_PAGES; i++)
+    free(run[i]);
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* Write and read pages through page aligned buffers, which O_DIRECT
+ * transfers without a bounce page, and mix them with unaligned ones */
+void
+testAlignedPages(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle run[NUM_TEST_PAGES];
+  SM_PageHandle unaligned;
+  void *buffer;
+  int i;
+
+  setTestName("test page aligned buffers");
+
+  for (i = 0; i < NUM_TEST_PAGES; i++)
+  {
+    ASSERT_TRUE(posix_memalign(&buffer, sysconf(_SC_PAGESIZE), PAGE_SIZE) == 0, "allocated an aligned page");
+    run[i] = (SM_PageHandle) buffer;
+    fillPage(run[i], i);
+  }
+  // one byte past an aligned buffer is never aligned
+  ASSERT_TRUE(posix_memalign(&buffer, sysconf(_SC_PAGESIZE), PAGE_SIZE + 1) == 0, "allocated an unaligned page");
+  unaligned = (SM_PageHandle) buffer + 1;
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (NUM_TEST_PAGES, &fh));
+  TEST_CHECK(writeBlocks (0, NUM_TEST_PAGES, &fh, run));
+
+  // an unaligned page overwrites one of the run
+  fillPage(unaligned, NUM_TEST_PAGES);
+  TEST_CHECK(writeBlock (1, &fh, unaligned));
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  for (i = 0; i < NUM_TEST_PAGES; i++)
+    memset(run[i], 0, PAGE_SIZE);
+  TEST_CHECK(readBlocks (0, NUM_TEST_PAGES, &fh, run));
+  ASSERT_TRUE(pageMatches(run[0], 0), "aligned page before the unaligned write");
+  ASSERT_TRUE(pageMatches(run[1], NUM_TEST_PAGES), "page written from an unaligned buffer");
+  for (i = 2; i < NUM_TEST_PAGES && pageMatches(run[i], i); i++)
+    ;
+  ASSERT_EQUALS_INT(NUM_TEST_PAGES, i, "aligned pages after the unaligned write");
+
+  memset(unaligned, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock (NUM_TEST_PAGES - 1, &fh, unaligned));
+  ASSERT_TRUE(pageMatches(unaligned, NUM_TEST_PAGES - 1), "page read into an unaligned buffer");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  for (i = 0; i < NUM_TEST_PAGES; i++)
+    free(run[i]);
+  free(unaligned - 1);
+
+  TEST_DONE();
+}
+
+/* Grow a file page by page and in large jumps, then read the new pages.
+ * The file on disk only covers the pages the handle asked for, however
+ * much was preallocated behind them. */
+void
+testEnsureCapacity(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph;
+  struct stat fileStat;
+  int i;
+
+  setTestName("test growing a file with ensureCapacity");
+
+  ph = (SM_PageHandle) malloc(PAGE_SIZE);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  fillPage(ph, 0);
+  TEST_CHECK(writeBlock (0, &fh, ph));
+
+  // page by page past the first preallocated chunk
+  for (i = 1; i < 40; i++)
+    TEST_CHECK(appendEmptyBlock (&fh));
+  ASSERT_EQUALS_INT(40, fh.totalNumPages, "pages after appending");
+
+  // asking for fewer pages than the file has changes nothing
+  TEST_CHECK(ensureCapacity (10, &fh));
+  ASSERT_EQUALS_INT(40, fh.totalNumPages, "file never shrinks");
+
+  // one jump far past the preallocated area
+  TEST_CHECK(ensureCapacity (1000, &fh));
+  ASSERT_EQUALS_INT(1000, fh.totalNumPages, "pages after growing");
+  if (configs[currentConfig].backend == &SM_PosixBackend)
+    ASSERT_TRUE(stat(TESTPF, &fileStat) == 0 && fileStat.st_size == 1000L * PAGE_SIZE, "file size follows the page count");
+
+  // the new pages read as empty pages, the old one is untouched
+  for (i = 1; i < 1000; i += 37)
+  {
+    memset(ph, 1, PAGE_SIZE);
+    TEST_CHECK(readBlock (i, &fh, ph));
+    if (!pageIsEmpty(ph))
+      break;
+  }
+  ASSERT_TRUE(i >= 1000, "grown pages are empty");
+  TEST_CHECK(readLastBlock (&fh, ph));
+  ASSERT_TRUE(pageIsEmpty(ph), "last grown page is empty");
+  TEST_CHECK(readFirstBlock (&fh, ph));
+  ASSERT_TRUE(pageMatches(ph, 0), "first page survives growing");
+
+  // the new pages take writes and keep them across reopening
+  fillPage(ph, 999);
+  TEST_CHECK(writeBlock (999, &fh, ph));
+  fillPage(ph, 500);
+  TEST_CHECK(writeBlock (500, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(1000, fh.totalNumPages, "page count after reopening");
+  TEST_CHECK(readBlock (999, &fh, ph));
+  ASSERT_TRUE(pageMatches(ph, 999), "last grown page after reopening");
+  TEST_CHECK(readBlock (500, &fh, ph));
+  ASSERT_TRUE(pageMatches(ph, 500), "middle grown page after reopening");
+  TEST_CHECK(readBlock (501, &fh, ph));
+  ASSERT_TRUE(pageIsEmpty(ph), "page next to a written one is still empty");
+
+  // growing the reopened file again keeps the written pages
+  TEST_CHECK(ensureCapacity (1100, &fh));
+  TEST_CHECK(readBlock (1099, &fh, ph));
+  ASSERT_TRUE(pageIsEmpty(ph), "page grown after reopening is empty");
+  TEST_CHECK(readBlock (999, &fh, ph));
+  ASSERT_TRUE(pageMatches(ph, 999), "written page survives growing again");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* name the running test after the test and the configuration it runs in */
+void
+setTestName(char *name)
+{
+  static char buffer[256];
+
+  snprintf(buffer, sizeof(buffer), "%s (%s)", name, configs[currentConfig].name);
+  testName = buffer;
+}
+
+/* fill a page with a pattern that depends on its page number */
+void
+fillPage(SM_PageHandle ph, int pageNum)
+{
+  for (int i = 0; i < PAGE_SIZE; i++)
+    ph[i] = (char) ((i + pageNum * 7) % 26 + 'a');
+}
+
+/* check that a page holds the pattern of its page number */
+int
+pageMatches(SM_PageHandle ph, int pageNum)
+{
+  for (int i = 0; i < PAGE_SIZE; i++)
+    if (ph[i] != (char) ((i + pageNum * 7) % 26 + 'a'))
+      return 0;
+  return 1;
+}
+
+/* check that a page holds only zero bytes */
+int
+pageIsEmpty(SM_PageHandle ph)
+{
+  for (int i = 0; i < PAGE_SIZE; i++)
+    if (ph[i] != 0)
+      return 0;
+  return 1;
+}
@@ -0,0 +1,533 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether the content of a buffer pool is the same as an expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)				\
+		do {									\
+			char *real;								\
+			char *_exp = (char *) (expected);				\
+			real = sprintPoolContent(bm);					\
+			if (strcmp((_exp),real) != 0)					\
+			{									\
+				printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+				free(real);							\
+				exit(1);							\
+			}									\
+			printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+			free(real);								\
+		} while(0)
+
+// what a step of a replacement test does with its page
+typedef enum StepAction {
+	PIN_UNPIN,	// pin the page and unpin it right away
+	PIN_DIRTY,	// pin the page, mark it dirty and unpin it
+	PIN_KEEP,	// pin the page and keep it pinned
+	UNPIN		// unpin a page pinned by an earlier step
+} StepAction;
+
+// one step of a replacement test and the pool content expected after it
+typedef struct Step {
+	StepAction action;
+	PageNumber page;
+	const char *content;
+} Step;
+
+#define NUM_STEPS(steps) ((int) (sizeof(steps) / sizeof(steps[0])))
+
+// test and helper methods
+static void createDummyPages(BM_BufferPool *bm, int num);
+static void runSteps(BM_BufferPool *bm, const Step *steps, int numSteps);
+static bool inPool(BM_BufferPool *bm, PageNumber page);
+
+static void testFIFO (void);
+static void testLRU (void);
+static void testCLOCK (void);
+static void testLFU (void);
+static void testLRU_K (void);
+static void testARC (void);
+
+// main method
+int
+main (void)
+{
+	initStorageManager();
+	testName = "";
+
+	testFIFO();
+	testLRU();
+	testCLOCK();
+	testLFU();
+	testLRU_K();
+	testARC();
+
+	return 0;
+}
+
+// create n pages with content "Page X" through a FIFO pool
+void
+createDummyPages(BM_BufferPool *bm, int num)
+{
+	int i;
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+	CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+	for (i = 0; i < num; i++)
+	{
+		CHECK(pinPage(bm, h, i));
+		sprintf(h->data, "%s-%i", "Page", h->pageNum);
+		CHECK(markDirty(bm, h));
+		CHECK(unpinPage(bm,h));
+	}
+
+	CHECK(shutdownBufferPool(bm));
+
+	free(h);
+}
+
+// run the steps of a replacement test against a pool, checking the pool
+// content after every step and the content of every page pinned
+void
+runSteps(BM_BufferPool *bm, const Step *steps, int numSteps)
+{
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	char expected[32];
+
+	for (int i = 0; i < numSteps; i++)
+	{
+		if (steps[i].action == UNPIN)
+		{
+			h->pageNum = steps[i].page;
+			CHECK(unpinPage(bm, h));
+		}
+		else
+		{
+			CHECK(pinPage(bm, h, steps[i].page));
+			sprintf(expected, "%s-%i", "Page", steps[i].page);
+			ASSERT_TRUE(strcmp(h->data, expected) == 0, "pinned page holds its content");
+			if (steps[i].action == PIN_DIRTY)
+				CHECK(markDirty(bm, h));
+			if (steps[i].action != PIN_KEEP)
+				CHECK(unpinPage(bm, h));
+		}
+		ASSERT_EQUALS_POOL(steps[i].content, bm, "check pool content");
+	}
+
+	free(h);
+}
+
+// check whether a page is in one of the frames of a pool
+bool
+inPool(BM_BufferPool *bm, PageNumber page)
+{
+	PageNumber *frameContent = getFrameContents(bm);
+	bool found = false;
+
+	for (int i = 0; i < bm->numPages; i++)
+		if (frameContent[i] == page)
+			found = true;
+	free(frameContent);
+	return found;
+}
+
+// test the FIFO page replacement strategy and the eviction counters
+void
+testFIFO (void)
+{
+	const Step steps[] = {
+		// read first three pages, the first page replaced is the first one read
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0]" },
+		{ PIN_UNPIN, 3, "[3 0],[1 0],[2 0]" },
+		{ PIN_UNPIN, 4, "[3 0],[4 0],[2 0]" },
+		// pin one page and test remainder
+		{ PIN_KEEP, 4, "[3 0],[4 1],[2 0]" },
+		// read pages and mark them as dirty
+		{ PIN_DIRTY, 5, "[3 0],[4 1],[5x0]" },
+		{ PIN_DIRTY, 6, "[6x0],[4 1],[5x0]" },
+		{ PIN_DIRTY, 0, "[6x0],[4 1],[0x0]" },
+		{ UNPIN, 4, "[6x0],[4 0],[0x0]" }
+	};
+	const Step dirtySteps[] = {
+		// dirty two of the three pages, hits leave the FIFO order alone
+		{ PIN_DIRTY, 6, "[6x0],[4 0],[0 0]" },
+		{ PIN_DIRTY, 0, "[6x0],[4 0],[0x0]" },
+		// replacement goes on with the frame after the one page 0 went to
+		{ PIN_UNPIN, 7, "[7 0],[4 0],[0x0]" },
+		{ PIN_UNPIN, 8, "[7 0],[8 0],[0x0]" },
+		{ PIN_UNPIN, 9, "[7 0],[8 0],[9 0]" }
+	};
+	BM_BufferPool *bm = MAKE_POOL();
+	testName = "Testing FIFO page replacement";
+
+	CHECK(createPageFile("testbuffer.bin"));
+	createDummyPages(bm, 100);
+	CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+	runSteps(bm, steps, NUM_STEPS(steps));
+
+	// four clean pages were replaced and the dirty page 5
+	ASSERT_EQUALS_INT(4, getNumCleanEvictions(bm), "check number of clean evictions");
+	ASSERT_EQUALS_INT(1, getNumDirtyEvictions(bm), "check number of dirty evictions");
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "check number of write I/Os");
+
+	// flush buffer pool to disk
+	CHECK(forceFlushPool(bm));
+	ASSERT_EQUALS_POOL("[6 0],[4 0],[0 0]", bm, "pool content after flush");
+	ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+	runSteps(bm, dirtySteps, NUM_STEPS(dirtySteps));
+
+	// only the dirty victims were written
+	ASSERT_EQUALS_INT(5, getNumCleanEvictions(bm), "check number of clean evictions");
+	ASSERT_EQUALS_INT(3, getNumDirtyEvictions(bm), "check number of dirty evictions");
+	ASSERT_EQUALS_INT(5, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(11, getNumReadIO(bm), "check number of read I/Os");
+
+	CHECK(shutdownBufferPool(bm));
+	CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// test the LRU page replacement strategy
+void
+testLRU (void)
+{
+	const Step steps[] = {
+		// read first five pages and directly unpin them
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0],[-1 0]" },
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		// use some of the pages to create a fixed LRU order without changing pool content
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		// check that pages get evicted in LRU order
+		{ PIN_UNPIN, 5, "[0 0],[1 0],[2 0],[5 0],[4 0]" },
+		{ PIN_UNPIN, 6, "[0 0],[1 0],[2 0],[5 0],[6 0]" },
+		{ PIN_UNPIN, 7, "[7 0],[1 0],[2 0],[5 0],[6 0]" },
+		{ PIN_UNPIN, 8, "[7 0],[1 0],[8 0],[5 0],[6 0]" },
+		{ PIN_UNPIN, 9, "[7 0],[9 0],[8 0],[5 0],[6 0]" },
+		// a pinned page is skipped, a dirty one is written back when evicted
+		{ PIN_KEEP, 5, "[7 0],[9 0],[8 0],[5 1],[6 0]" },
+		{ PIN_UNPIN, 10, "[7 0],[9 0],[8 0],[5 1],[10 0]" },
+		{ PIN_DIRTY, 7, "[7x0],[9 0],[8 0],[5 1],[10 0]" },
+		{ PIN_UNPIN, 11, "[7x0],[9 0],[11 0],[5 1],[10 0]" },
+		{ PIN_UNPIN, 12, "[7x0],[12 0],[11 0],[5 1],[10 0]" },
+		{ PIN_UNPIN, 13, "[7x0],[12 0],[11 0],[5 1],[13 0]" },
+		{ PIN_UNPIN, 14, "[14 0],[12 0],[11 0],[5 1],[13 0]" },
+		{ UNPIN, 5, "[14 0],[12 0],[11 0],[5 0],[13 0]" }
+	};
+	BM_BufferPool *bm = MAKE_POOL();
+	testName = "Testing LRU page replacement";
+
+	CHECK(createPageFile("testbuffer.bin"));
+	createDummyPages(bm, 100);
+	CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU, NULL));
+
+	runSteps(bm, steps, NUM_STEPS(steps));
+
+	// check number of write IOs
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(15, getNumReadIO(bm), "check number of read I/Os");
+
+	CHECK(shutdownBufferPool(bm));
+	CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// test the CLOCK page replacement strategy
+void
+testCLOCK (void)
+{
+	const Step steps[] = {
+		// read first five pages, every load sets the reference bit
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0],[-1 0]" },
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[2 0],[3 0],[4 0]" },
+		// the hand clears every bit once and comes back to the first frame
+		{ PIN_UNPIN, 5, "[5 0],[1 0],[2 0],[3 0],[4 0]" },
+		// hits give pages 2 and 3 a second chance
+		{ PIN_UNPIN, 2, "[5 0],[1 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 3, "[5 0],[1 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 6, "[5 0],[6 0],[2 0],[3 0],[4 0]" },
+		{ PIN_UNPIN, 7, "[5 0],[6 0],[2 0],[3 0],[7 0]" },
+		// the second chance is used up, the hand takes them next time around
+		{ PIN_UNPIN, 8, "[5 0],[6 0],[8 0],[3 0],[7 0]" },
+		{ PIN_UNPIN, 9, "[5 0],[6 0],[8 0],[9 0],[7 0]" },
+		// a pinned page is skipped, a dirty one is written back when evicted
+		{ PIN_KEEP, 7, "[5 0],[6 0],[8 0],[9 0],[7 1]" },
+		{ PIN_DIRTY, 6, "[5 0],[6x0],[8 0],[9 0],[7 1]" },
+		{ PIN_UNPIN, 10, "[10 0],[6x0],[8 0],[9 0],[7 1]" },
+		{ PIN_UNPIN, 11, "[10 0],[11 0],[8 0],[9 0],[7 1]" },
+		{ PIN_UNPIN, 12, "[10 0],[11 0],[12 0],[9 0],[7 1]" },
+		{ PIN_UNPIN, 13, "[10 0],[11 0],[12 0],[13 0],[7 1]" },
+		{ UNPIN, 7, "[10 0],[11 0],[12 0],[13 0],[7 0]" }
+	};
+	BM_BufferPool *bm = MAKE_POOL();
+	testName = "Testing CLOCK page replacement";
+
+	CHECK(createPageFile("testbuffer.bin"));
+	createDummyPages(bm, 100);
+	CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_CLOCK, NULL));
+
+	runSteps(bm, steps, NUM_STEPS(steps));
+
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(14, getNumReadIO(bm), "check number of read I/Os");
+
+	CHECK(shutdownBufferPool(bm));
+	CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// test the LFU page replacement strategy
+void
+testLFU (void)
+{
+	const Step steps[] = {
+		// read first four pages
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		// reference page 0 four times, page 1 three times and page 2 twice
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[3 0]" },
+		// new pages replace each other, the referenced pages stay
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[2 0],[4 0]" },
+		{ PIN_UNPIN, 5, "[0 0],[1 0],[2 0],[5 0]" },
+		// a pinned page is skipped, the least frequent unpinned one goes
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[2 0],[5 0]" },
+		{ PIN_KEEP, 5, "[0 0],[1 0],[2 0],[5 1]" },
+		{ PIN_UNPIN, 6, "[0 0],[1 0],[6 0],[5 1]" },
+		// a dirty page is written back when evicted
+		{ PIN_DIRTY, 6, "[0 0],[1 0],[6x0],[5 1]" },
+		{ PIN_UNPIN, 7, "[0 0],[1 0],[7 0],[5 1]" },
+		{ UNPIN, 5, "[0 0],[1 0],[7 0],[5 0]" },
+		{ PIN_UNPIN, 8, "[0 0],[1 0],[8 0],[5 0]" }
+	};
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	int i;
+	testName = "Testing LFU page replacement";
+
+	CHECK(createPageFile("testbuffer.bin"));
+	createDummyPages(bm, 200);
+	CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LFU, NULL));
+
+	runSteps(bm, steps, NUM_STEPS(steps));
+
+	ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(9, getNumReadIO(bm), "check number of read I/Os");
+
+	CHECK(shutdownBufferPool(bm));
+
+	// a page that was hot once ages out while other pages stream through
+	testName = "Testing LFU aging";
+	CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+
+	for (i = 0; i < 20; i++)
+	{
+		CHECK(pinPage(bm, h, 0));
+		CHECK(unpinPage(bm, h));
+	}
+	for (i = 1; i <= 100; i++)
+	{
+		CHECK(pinPage(bm, h, i));
+		CHECK(unpinPage(bm, h));
+	}
+	ASSERT_TRUE(inPool(bm, 0), "hot page survives a stream of new pages");
+	for (; i <= 110 && inPool(bm, 0); i++)
+	{
+		CHECK(pinPage(bm, h, i));
+		CHECK(unpinPage(bm, h));
+	}
+	ASSERT_TRUE(!inPool(bm, 0), "hot page ages out eventually");
+
+	CHECK(shutdownBufferPool(bm));
+	CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// test the LRU-K page replacement strategy with K passed as stratData
+void
+testLRU_K (void)
+{
+	const Step stepsK2[] = {
+		// reference pages 0 and 1 twice
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		// a scan of pages referenced once only replaces its own pages
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[4 0],[3 0]" },
+		{ PIN_UNPIN, 5, "[0 0],[1 0],[4 0],[5 0]" },
+		{ PIN_UNPIN, 6, "[0 0],[1 0],[6 0],[5 0]" },
+		{ PIN_UNPIN, 7, "[0 0],[1 0],[6 0],[7 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[6 0],[7 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[6 0],[7 0]" },
+		// page 4 was evicted, but its history remembers its first reference
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[4 0],[7 0]" },
+		{ PIN_UNPIN, 8, "[0 0],[1 0],[4 0],[8 0]" },
+		{ PIN_UNPIN, 9, "[0 0],[1 0],[4 0],[9 0]" },
+		// with K references each, the oldest second to last reference goes first
+		{ PIN_KEEP, 4, "[0 0],[1 0],[4 1],[9 0]" },
+		{ PIN_DIRTY, 9, "[0 0],[1 0],[4 1],[9x0]" },
+		{ PIN_UNPIN, 10, "[10 0],[1 0],[4 1],[9x0]" },
+		{ PIN_UNPIN, 11, "[11 0],[1 0],[4 1],[9x0]" },
+		{ UNPIN, 4, "[11 0],[1 0],[4 0],[9x0]" },
+		{ PIN_UNPIN, 12, "[12 0],[1 0],[4 0],[9x0]" }
+	};
+	const Step stepsK3[] = {
+		// two references are not enough for K = 3
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 4, "[4 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 5, "[4 0],[5 0],[2 0],[3 0]" }
+	};
+	BM_BufferPool *bm = MAKE_POOL();
+	int k;
+	testName = "Testing LRU-K page replacement";
+
+	CHECK(createPageFile("testbuffer.bin"));
+	createDummyPages(bm, 100);
+
+	k = 2;
+	CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU_K, &k));
+	runSteps(bm, stepsK2, NUM_STEPS(stepsK2));
+	ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(14, getNumReadIO(bm), "check number of read I/Os");
+	CHECK(shutdownBufferPool(bm));
+
+	k = 3;
+	CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU_K, &k));
+	runSteps(bm, stepsK3, NUM_STEPS(stepsK3));
+	ASSERT_EQUALS_INT(6, getNumReadIO(bm), "check number of read I/Os");
+	CHECK(shutdownBufferPool(bm));
+
+	CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// test the ARC page replacement strategy
+void
+testARC (void)
+{
+	const Step scanSteps[] = {
+		// pages 0 and 1 are referenced twice and move to the frequent list
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		// a scan only replaces pages of the recent list
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[4 0],[3 0]" },
+		{ PIN_UNPIN, 5, "[0 0],[1 0],[4 0],[5 0]" },
+		{ PIN_UNPIN, 6, "[0 0],[1 0],[6 0],[5 0]" },
+		{ PIN_UNPIN, 7, "[0 0],[1 0],[6 0],[7 0]" },
+		// second references fill the frequent list, its oldest page goes
+		// when the recent list is empty
+		{ PIN_DIRTY, 7, "[0 0],[1 0],[6 0],[7x0]" },
+		{ PIN_KEEP, 6, "[0 0],[1 0],[6 1],[7x0]" },
+		{ PIN_UNPIN, 8, "[8 0],[1 0],[6 1],[7x0]" },
+		// afterwards new pages replace each other again
+		{ PIN_UNPIN, 9, "[9 0],[1 0],[6 1],[7x0]" },
+		{ UNPIN, 6, "[9 0],[1 0],[6 0],[7x0]" },
+		{ PIN_UNPIN, 10, "[10 0],[1 0],[6 0],[7x0]" }
+	};
+	const Step loopSteps[] = {
+		// pages 0 and 1 are referenced twice and move to the frequent list
+		{ PIN_UNPIN, 0, "[0 0],[-1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 0, "[0 0],[1 0],[-1 0],[-1 0]" },
+		{ PIN_UNPIN, 1, "[0 0],[1 0],[-1 0],[-1 0]" },
+		// a scan of three pages does not fit into the recent list
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[2 0],[-1 0]" },
+		{ PIN_UNPIN, 3, "[0 0],[1 0],[2 0],[3 0]" },
+		{ PIN_UNPIN, 4, "[0 0],[1 0],[4 0],[3 0]" },
+		// the scan repeats, its evicted pages are found in the recent ghost
+		// list and go to the frequent list, the recent list grows its target
+		{ PIN_UNPIN, 2, "[0 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 3, "[3 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 4, "[3 0],[1 0],[4 0],[2 0]" },
+		// from now on the scan only hits
+		{ PIN_UNPIN, 2, "[3 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 3, "[3 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 4, "[3 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 2, "[3 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 3, "[3 0],[1 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 4, "[3 0],[1 0],[4 0],[2 0]" },
+		// the pages the scan pushed out come back through the frequent
+		// ghost list and replace the oldest frequent pages
+		{ PIN_UNPIN, 0, "[3 0],[0 0],[4 0],[2 0]" },
+		{ PIN_UNPIN, 1, "[3 0],[0 0],[4 0],[1 0]" }
+	};
+	BM_BufferPool *bm = MAKE_POOL();
+	testName = "Testing ARC page replacement";
+
+	CHECK(createPageFile("testbuffer.bin"));
+	createDummyPages(bm, 100);
+
+	CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_ARC, NULL));
+	runSteps(bm, scanSteps, NUM_STEPS(scanSteps));
+	ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+	ASSERT_EQUALS_INT(11, getNumReadIO(bm), "check number of read I/Os");
+	CHECK(shutdownBufferPool(bm));
+
+	testName = "Testing ARC adapting to a repeated scan";
+	CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_ARC, NULL));
+	runSteps(bm, loopSteps, NUM_STEPS(loopSteps));
+	ASSERT_EQUALS_INT(9, getNumReadIO(bm), "check number of read I/Os");
+	CHECK(shutdownBufferPool(bm));
+
+	CHECK(destroyPageFile("testbuffer.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
@@ -0,0 +1,329 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "test_helper.h"
+
+#define QUEUE_DEPTH 4
+#define NUM_PAGES 64
+#define NUM_THREADS 4
+
+// state shared with one reaper thread
+typedef struct Reaper {
+	SM_AsyncQueue *queue;
+	SM_FileHandle *fh;
+	int id;
+	int submitted;
+	int reaped;
+	int failed;
+} Reaper;
+
+// test methods
+static void testQueueFull (void);
+static void testWriteThenRead (void);
+static void testConcurrentReapers (void);
+
+// helper methods
+static void *reapWorker (void *arg);
+static void fillPage (SM_PageHandle ph, int pageNum);
+static int pageMatches (SM_PageHandle ph, int pageNum);
+
+// test name
+char *testName;
+
+#define TESTPF "test_async_queue.bin"
+
+// main method
+int
+main (void)
+{
+	testName = "";
+
+	initStorageManager();
+
+	testQueueFull();
+	testWriteThenRead();
+	testConcurrentReapers();
+
+	return 0;
+}
+
+// ************************************************************
+// a queue takes queueDepth requests, the next one is refused until a
+// completion is reaped
+void
+testQueueFull (void)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue queue;
+	SM_Completion completions[QUEUE_DEPTH];
+	SM_PageHandle pages[QUEUE_DEPTH + 1];
+	int seen[QUEUE_DEPTH + 1] = {0};
+	int numReaped = 0;
+	RC rc;
+
+	testName = "test submitting more requests than the queue depth";
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	TEST_CHECK(ensureCapacity(NUM_PAGES, &fh));
+	TEST_CHECK(initAsyncQueue(&queue, QUEUE_DEPTH));
+	ASSERT_EQUALS_INT(QUEUE_DEPTH, queue.queueDepth, "queue depth");
+
+	for (int i = 0; i <= QUEUE_DEPTH; i++)
+		pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+
+	// fill the queue, the request after it does not fit
+	for (int i = 0; i < QUEUE_DEPTH; i++)
+		TEST_CHECK(submitReadBlock(&queue, i, &fh, pages[i], (void *) (intptr_t) i));
+	ASSERT_EQUALS_INT(QUEUE_DEPTH, queue.numInFlight, "queue is full");
+	rc = submitReadBlock(&queue, QUEUE_DEPTH, &fh, pages[QUEUE_DEPTH], NULL);
+	ASSERT_EQUALS_INT(RC_ASYNC_QUEUE_FULL, rc, "read on a full queue");
+	rc = submitWriteBlock(&queue, QUEUE_DEPTH, &fh, pages[QUEUE_DEPTH], NULL);
+	ASSERT_EQUALS_INT(RC_ASYNC_QUEUE_FULL, rc, "write on a full queue");
+
+	// one reaped completion makes room for one more request
+	numReaped = reapCompletions(&queue, completions, 1, 1);
+	ASSERT_EQUALS_INT(1, numReaped, "reaped one completion");
+	seen[(intptr_t) completions[0].userData]++;
+	TEST_CHECK(submitReadBlock(&queue, QUEUE_DEPTH, &fh, pages[QUEUE_DEPTH], (void *) (intptr_t) QUEUE_DEPTH));
+	rc = submitReadBlock(&queue, 0, &fh, pages[0], NULL);
+	ASSERT_EQUALS_INT(RC_ASYNC_QUEUE_FULL, rc, "queue is full again");
+
+	// collect the rest, every request completes exactly once
+	while (queue.numInFlight > 0){
+		int n = reapCompletions(&queue, completions, QUEUE_DEPTH, 1);
+		for (int i = 0; i < n; i++){
+			ASSERT_EQUALS_INT(RC_OK, completions[i].rc, "read succeeded");
+			ASSERT_EQUALS_INT((int) (intptr_t) completions[i].userData, completions[i].pageNum, "user data belongs to the page");
+			seen[(intptr_t) completions[i].userData]++;
+		}
+		numReaped += n;
+	}
+	ASSERT_EQUALS_INT(QUEUE_DEPTH + 1, numReaped, "every request completed");
+	for (int i = 0; i <= QUEUE_DEPTH; i++)
+		ASSERT_EQUALS_INT(1, seen[i], "request completed once");
+	numReaped = reapCompletions(&queue, completions, QUEUE_DEPTH, 1);
+	ASSERT_EQUALS_INT(0, numReaped, "nothing left to reap");
+
+	TEST_CHECK(shutdownAsyncQueue(&queue));
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+	for (int i = 0; i <= QUEUE_DEPTH; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+// write every page of a file through the queue, then read it back through
+// the queue. The queue is kept full, so requests wait for completions.
+void
+testWriteThenRead (void)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue queue;
+	SM_Completion completions[QUEUE_DEPTH];
+	SM_PageHandle pages[NUM_PAGES];
+	int next, done, n;
+	RC rc;
+
+	testName = "test writing and reading pages through the queue";
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	TEST_CHECK(ensureCapacity(NUM_PAGES, &fh));
+	TEST_CHECK(initAsyncQueue(&queue, QUEUE_DEPTH));
+
+	for (int i = 0; i < NUM_PAGES; i++){
+		pages[i] = (SM_PageHandle) malloc(PAGE_SIZE);
+		fillPage(pages[i], i);
+	}
+
+	// writes, a full queue is drained before submitting more
+	for (next = 0, done = 0; done < NUM_PAGES; ){
+		while (next < NUM_PAGES && (rc = submitWriteBlock(&queue, next, &fh, pages[next], pages[next])) == RC_OK)
+			next++;
+		if (next < NUM_PAGES)
+			ASSERT_EQUALS_INT(RC_ASYNC_QUEUE_FULL, rc, "only a full queue refuses a write");
+		n = reapCompletions(&queue, completions, QUEUE_DEPTH, 1);
+		for (int i = 0; i < n; i++){
+			if (completions[i].rc != RC_OK || completions[i].userData != pages[completions[i].pageNum]){
+				ASSERT_EQUALS_INT(RC_OK, completions[i].rc, "write succeeded");
+				ASSERT_TRUE(completions[i].userData == pages[completions[i].pageNum], "user data of the write");
+			}
+		}
+		done += n;
+	}
+	ASSERT_EQUALS_INT(NUM_PAGES, done, "every write completed");
+
+	// the writes are on disk
+	TEST_CHECK(readBlock(NUM_PAGES / 2, &fh, pages[0]));
+	ASSERT_TRUE(pageMatches(pages[0], NUM_PAGES / 2), "page written through the queue");
+
+	// reads into cleared pages
+	for (int i = 0; i < NUM_PAGES; i++)
+		memset(pages[i], 0, PAGE_SIZE);
+	for (next = 0, done = 0; done < NUM_PAGES; ){
+		while (next < NUM_PAGES && submitReadBlock(&queue, next, &fh, pages[next], pages[next]) == RC_OK)
+			next++;
+		n = reapCompletions(&queue, completions, QUEUE_DEPTH, 1);
+		for (int i = 0; i < n; i++){
+			if (completions[i].rc != RC_OK || completions[i].userData != pages[completions[i].pageNum]
+					|| !pageMatches(pages[completions[i].pageNum], completions[i].pageNum)){
+				ASSERT_EQUALS_INT(RC_OK, completions[i].rc, "read succeeded");
+				ASSERT_TRUE(completions[i].userData == pages[completions[i].pageNum], "user data of the read");
+				ASSERT_TRUE(pageMatches(pages[completions[i].pageNum], completions[i].pageNum), "page read through the queue");
+			}
+		}
+		done += n;
+	}
+	ASSERT_EQUALS_INT(NUM_PAGES, done, "every read completed");
+
+	// pages beyond the file are refused before they reach the queue
+	rc = submitReadBlock(&queue, NUM_PAGES, &fh, pages[0], NULL);
+	ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "read past the end");
+	rc = submitWriteBlock(&queue, -1, &fh, pages[0], NULL);
+	ASSERT_EQUALS_INT(RC_PAGE_NOT_FOUND, rc, "write before the start");
+	ASSERT_EQUALS_INT(0, queue.numInFlight, "refused requests are not in flight");
+
+	// so are pages of a closed file, whatever their number
+	TEST_CHECK(closePageFile(&fh));
+	rc = submitReadBlock(&queue, NUM_PAGES, &fh, pages[0], NULL);
+	ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, rc, "read from a closed file");
+	rc = submitWriteBlock(&queue, 0, &fh, pages[0], NULL);
+	ASSERT_EQUALS_INT(RC_FILE_HANDLE_NOT_INIT, rc, "write to a closed file");
+
+	TEST_CHECK(shutdownAsyncQueue(&queue));
+	TEST_CHECK(destroyPageFile(TESTPF));
+	for (int i = 0; i < NUM_PAGES; i++)
+		free(pages[i]);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+// several threads submit to and reap from one queue. A completion may be
+// reaped by any thread, but each one is reaped exactly once.
+void
+testConcurrentReapers (void)
+{
+	SM_FileHandle fh;
+	SM_AsyncQueue queue;
+	SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+	pthread_t threads[NUM_THREADS];
+	Reaper reapers[NUM_THREADS];
+	int submitted = 0;
+	int reaped = 0;
+
+	testName = "test several threads sharing one queue";
+
+	TEST_CHECK(createPageFile(TESTPF));
+	TEST_CHECK(openPageFile(TESTPF, &fh));
+	TEST_CHECK(ensureCapacity(NUM_PAGES, &fh));
+	for (int i = 0; i < NUM_PAGES; i++){
+		fillPage(ph, i);
+		TEST_CHECK(writeBlock(i, &fh, ph));
+	}
+	TEST_CHECK(initAsyncQueue(&queue, QUEUE_DEPTH));
+
+	for (int i = 0; i < NUM_THREADS; i++){
+		reapers[i].queue = &queue;
+		reapers[i].fh = &fh;
+		reapers[i].id = i;
+		reapers[i].submitted = 0;
+		reapers[i].reaped = 0;
+		reapers[i].failed = 0;
+		int rc = pthread_create(&threads[i], NULL, reapWorker, &reapers[i]);
+		ASSERT_EQUALS_INT(0, rc, "start thread");
+	}
+	for (int i = 0; i < NUM_THREADS; i++){
+		pthread_join(threads[i], NULL);
+		ASSERT_EQUALS_INT(0, reapers[i].failed, "thread saw only correct completions");
+		submitted += reapers[i].submitted;
+		reaped += reapers[i].reaped;
+	}
+
+	ASSERT_EQUALS_INT(NUM_THREADS * NUM_PAGES, submitted, "every thread submitted every page");
+	ASSERT_EQUALS_INT(submitted, reaped, "every request was reaped once");
+	ASSERT_EQUALS_INT(0, queue.numInFlight, "nothing left in flight");
+
+	TEST_CHECK(shutdownAsyncQueue(&queue));
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(TESTPF));
+	free(ph);
+
+	TEST_DONE();
+}
+
+// reads every page of the file into a page of its own, reaping whatever
+// completes in between. A reaped read of another thread is checked the same
+// way, its page stays valid until every thread is done.
+static void *
+reapWorker (void *arg)
+{
+	Reaper *r = (Reaper *) arg;
+	SM_Completion completions[QUEUE_DEPTH];
+	SM_PageHandle *pages = (SM_PageHandle *) malloc(sizeof(SM_PageHandle) * NUM_PAGES);
+	static int finished = 0;
+	int n;
+
+	for (int i = 0; i < NUM_PAGES; i++)
+		pages[i] = (SM_PageHandle) calloc(1, PAGE_SIZE);
+
+	while (r->submitted < NUM_PAGES || __atomic_load_n(&finished, __ATOMIC_ACQUIRE) < NUM_THREADS){
+		if (r->submitted < NUM_PAGES){
+			int page = (r->submitted + r->id * 7) % NUM_PAGES;
+			RC rc = submitReadBlock(r->queue, page, r->fh, pages[page], pages[page]);
+			if (rc == RC_OK){
+				r->submitted++;
+				if (r->submitted == NUM_PAGES)
+					__atomic_add_fetch(&finished, 1, __ATOMIC_RELEASE);
+				continue;
+			}
+			if (rc != RC_ASYNC_QUEUE_FULL)
+				r->failed++;
+		}
+		n = reapCompletions(r->queue, completions, QUEUE_DEPTH, 0);
+		for (int i = 0; i < n; i++){
+			if (completions[i].rc != RC_OK || !pageMatches((SM_PageHandle) completions[i].userData, completions[i].pageNum))
+				r->failed++;
+		}
+		r->reaped += n;
+	}
+
+	// the last submissions of the other threads may still be in flight
+	while ((n = reapCompletions(r->queue, completions, QUEUE_DEPTH, 1)) > 0){
+		for (int i = 0; i < n; i++){
+			if (completions[i].rc != RC_OK || !pageMatches((SM_PageHandle) completions[i].userData, completions[i].pageNum))
+				r->failed++;
+		}
+		r->reaped += n;
+	}
+
+	// every thread submitted its last request and nothing is in flight
+	for (int i = 0; i < NUM_PAGES; i++)
+		free(pages[i]);
+	free(pages);
+
+	return NULL;
+}
+
+// fill a page with a pattern that depends on its page number
+static void
+fillPage (SM_PageHandle ph, int pageNum)
+{
+	for (int i = 0; i < PAGE_SIZE; i++)
+		ph[i] = (char) ((i + pageNum * 13) % 26 + 'A');
+}
+
+// check that a page holds the pattern of its page number
+static int
+pageMatches (SM_PageHandle ph, int pageNum)
+{
+	for (int i = 0; i < PAGE_SIZE; i++)
+		if (ph[i] != (char) ((i + pageNum * 13) % 26 + 'A'))
+			return 0;
+	return 1;
+}
@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "storage_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+// test name
+char *testName;
+
+/* test output files */
+#define TESTPF "test_compressed.bin"
+
+/* layout of a compressed page file: a header with the magic, the page count
+ * and the offset of the page map, then the stored pages, then the page map
+ * with an offset, a length and a capacity per page */
+#define LZ_HEADER_SIZE 16
+#define LZ_MAP_OFFSET_POS 8
+#define LZ_EXTENT_SIZE 16
+
+/* prototypes for test functions */
+static void testZeroPage(void);
+static void testRandomPage(void);
+static void testRepetitivePage(void);
+static void testGrowingRewrite(void);
+static void testCorruptPage(void);
+static void testTruncatedFile(void);
+
+/* helper methods */
+static void fillRandom(SM_PageHandle ph, unsigned seed);
+static void fillRepetitive(SM_PageHandle ph);
+static long fileSize(char *fileName);
+static int64_t mapOffset(char *fileName);
+static void overwrite(char *fileName, off_t offset, const void *data, size_t size);
+
+/* main function running all tests */
+int
+main (void)
+{
+  testName = "";
+
+  initStorageManager();
+  setStorageBackend(&SM_CompressedBackend);
+
+  testZeroPage();
+  testRandomPage();
+  testRepetitivePage();
+  testGrowingRewrite();
+  testCorruptPage();
+  testTruncatedFile();
+
+  return 0;
+}
+
+
+/* a page of zeros shrinks to a few bytes and reads back as zeros */
+void
+testZeroPage(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle expected = (SM_PageHandle) calloc(1, PAGE_SIZE);
+
+  testName = "test compressing an all zero page";
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(writeBlock (0, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  ASSERT_TRUE(fileSize(TESTPF) < LZ_HEADER_SIZE + LZ_EXTENT_SIZE + 64, "zero page takes a few bytes on disk");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  memset(ph, 1, PAGE_SIZE);
+  TEST_CHECK(readBlock (0, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "zero page reads back as zeros");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(expected);
+
+  TEST_DONE();
+}
+
+/* random bytes do not compress, the page is stored as is */
+void
+testRandomPage(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle expected = (SM_PageHandle) malloc(PAGE_SIZE);
+  int fd;
+
+  testName = "test storing a random page as is";
+
+  fillRandom(expected, 1);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(writeBlock (0, &fh, expected));
+  TEST_CHECK(closePageFile (&fh));
+
+  // the raw page follows the header and takes a full page
+  ASSERT_TRUE(mapOffset(TESTPF) == LZ_HEADER_SIZE + PAGE_SIZE, "random page takes a full page");
+  fd = open(TESTPF, O_RDONLY);
+  ASSERT_TRUE(fd >= 0 && pread(fd, ph, PAGE_SIZE, LZ_HEADER_SIZE) == PAGE_SIZE, "read the stored page");
+  close(fd);
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "page is stored as is");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  memset(ph, 0, PAGE_SIZE);
+  TEST_CHECK(readBlock (0, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, expected, PAGE_SIZE) == 0, "random page reads back");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(expected);
+
+  TEST_DONE();
+}
+
+/* padded records compress to a fraction of a page */
+void
+testRepetitivePage(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle expected = (SM_PageHandle) malloc(PAGE_SIZE);
+  int i;
+
+  testName = "test compressing a repetitive page";
+
+  fillRepetitive(expected);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (8, &fh));
+  for (i = 0; i < 8; i++)
+    TEST_CHECK(writeBlock (i, &fh, expected));
+  TEST_CHECK(closePageFile (&fh));
+
+  ASSERT_TRUE(mapOffset(TESTPF) - LZ_HEADER_SIZE < 8 * PAGE_SIZE / 4, "pages shrink to less than a quarter");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  ASSERT_EQUALS_INT(8, fh.totalNumPages, "page count after reopening");
+  for (i = 0; i < 8; i++)
+  {
+    memset(ph, 0, PAGE_SIZE);
+    TEST_CHECK(readBlock (i, &fh, ph));
+    if (memcmp(ph, expected, PAGE_SIZE) != 0)
+      break;
+  }
+  ASSERT_EQUALS_INT(8, i, "repetitive pages read back");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(expected);
+
+  TEST_DONE();
+}
+
+/* a page that no longer fits into its old space moves, its neighbours stay */
+void
+testGrowingRewrite(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle small = (SM_PageHandle) malloc(PAGE_SIZE);
+  SM_PageHandle large = (SM_PageHandle) malloc(PAGE_SIZE);
+  int64_t before;
+
+  testName = "test rewriting a page to a larger compressed size";
+
+  fillRepetitive(small);
+  fillRandom(large, 2);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (3, &fh));
+  TEST_CHECK(writeBlock (0, &fh, small));
+  TEST_CHECK(writeBlock (1, &fh, small));
+  TEST_CHECK(writeBlock (2, &fh, small));
+  TEST_CHECK(closePageFile (&fh));
+  before = mapOffset(TESTPF);
+
+  // the middle page grows, it must not run into the page behind it
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(writeBlock (1, &fh, large));
+  TEST_CHECK(readBlock (1, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, large, PAGE_SIZE) == 0, "grown page reads back");
+  TEST_CHECK(readBlock (2, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, small, PAGE_SIZE) == 0, "page behind the grown page is untouched");
+  TEST_CHECK(closePageFile (&fh));
+  ASSERT_TRUE(mapOffset(TESTPF) == before + PAGE_SIZE, "grown page moved to the end of the data area");
+
+  // shrinking it again reuses its new space
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(writeBlock (1, &fh, small));
+  TEST_CHECK(closePageFile (&fh));
+  ASSERT_TRUE(mapOffset(TESTPF) == before + PAGE_SIZE, "shrunk page is rewritten in place");
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(readBlock (0, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, small, PAGE_SIZE) == 0, "first page after reopening");
+  TEST_CHECK(readBlock (1, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, small, PAGE_SIZE) == 0, "rewritten page after reopening");
+  TEST_CHECK(readBlock (2, &fh, ph));
+  ASSERT_TRUE(memcmp(ph, small, PAGE_SIZE) == 0, "last page after reopening");
+
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+  free(small);
+  free(large);
+
+  TEST_DONE();
+}
+
+/* damaged compressed bytes are reported instead of expanded */
+void
+testCorruptPage(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  unsigned char garbage[32];
+  RC rc;
+
+  testName = "test reading a corrupt page";
+
+  fillRepetitive(ph);
+  memset(garbage, 0xff, sizeof(garbage));
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (2, &fh));
+  TEST_CHECK(writeBlock (0, &fh, ph));
+  TEST_CHECK(writeBlock (1, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  // the first compressed page starts right after the header
+  overwrite(TESTPF, LZ_HEADER_SIZE, garbage, sizeof(garbage));
+
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  rc = readBlock (0, &fh, ph);
+  ASSERT_EQUALS_INT(RC_BAD_FILE_FORMAT, rc, "corrupt page is rejected");
+  TEST_CHECK(readBlock (1, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* a file cut short, or a page map pointing past the data, is rejected when
+ * the file is opened */
+void
+testTruncatedFile(void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle ph = (SM_PageHandle) malloc(PAGE_SIZE);
+  int32_t length = PAGE_SIZE;
+  int64_t offset;
+  RC rc;
+
+  testName = "test opening a truncated file";
+
+  fillRepetitive(ph);
+
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (2, &fh));
+  TEST_CHECK(writeBlock (0, &fh, ph));
+  TEST_CHECK(writeBlock (1, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  // the page map of the last page is cut off
+  ASSERT_TRUE(truncate(TESTPF, fileSize(TESTPF) - 1) == 0, "truncated the file");
+  rc = openPageFile (TESTPF, &fh);
+  ASSERT_EQUALS_INT(RC_BAD_FILE_FORMAT, rc, "truncated page map is rejected");
+
+  // the map survives, but the last page claims more bytes than were stored
+  TEST_CHECK(destroyPageFile (TESTPF));
+  TEST_CHECK(createPageFile (TESTPF));
+  TEST_CHECK(openPageFile (TESTPF, &fh));
+  TEST_CHECK(ensureCapacity (2, &fh));
+  TEST_CHECK(writeBlock (0, &fh, ph));
+  TEST_CHECK(writeBlock (1, &fh, ph));
+  TEST_CHECK(closePageFile (&fh));
+
+  offset = mapOffset(TESTPF) + LZ_EXTENT_SIZE + sizeof(int64_t);
+  overwrite(TESTPF, offset, &length, sizeof(length));
+  overwrite(TESTPF, offset + sizeof(length), &length, sizeof(length));
+  rc = openPageFile (TESTPF, &fh);
+  ASSERT_EQUALS_INT(RC_BAD_FILE_FORMAT, rc, "page past the data area is rejected");
+
+  TEST_CHECK(destroyPageFile (TESTPF));
+  free(ph);
+
+  TEST_DONE();
+}
+
+/* fill a page with bytes that do not compress */
+void
+fillRandom(SM_PageHandle ph, unsigned seed)
+{
+  srand(seed);
+  for (int i = 0; i < PAGE_SIZE; i++)
+    ph[i] = (char) (rand() & 0xff);
+}
+
+/* fill a page like a record page: fixed width slots of short strings padded
+ * with zeros, every other slot tombstoned */
+void
+fillRepetitive(SM_PageHandle ph)
+{
+  memset(ph, 0, PAGE_SIZE);
+  for (int slot = 0; slot + 64 <= PAGE_SIZE; slot += 64)
+  {
+    ph[slot] = (slot / 64) % 2 ? 'O' : '+';
+    snprintf(ph + slot + 1, 16, "name%d", slot / 64);
+  }
+}
+
+/* size of a file on disk */
+long
+fileSize(char *fileName)
+{
+  struct stat fileStat;
+
+  if (stat(fileName, &fileStat) != 0)
+    return -1;
+  return (long) fileStat.st_size;
+}
+
+/* offset of the page map, the data area ends there */
+int64_t
+mapOffset(char *fileName)
+{
+  int64_t offset = -1;
+  int fd = open(fileName, O_RDONLY);
+
+  if (fd >= 0)
+  {
+    if (pread(fd, &offset, sizeof(offset), LZ_MAP_OFFSET_POS) != sizeof(offset))
+      offset = -1;
+    close(fd);
+  }
+  return offset;
+}
+
+/* overwrite bytes of a closed file */
+void
+overwrite(char *fileName, off_t offset, const void *data, size_t size)
+{
+  int fd = open(fileName, O_WRONLY);
+
+  ASSERT_TRUE(fd >= 0 && pwrite(fd, data, size, offset) == (ssize_t) size, "damaged the file");
+  close(fd);
+}
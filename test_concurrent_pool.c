@@ -0,0 +1,793 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "test_helper.h"
+
+#define NUM_THREADS 8
+#define NUM_FRAMES 32
+#define NUM_PAGES 200
+#define NUM_OPS 20000
+
+// every thread counts its updates of a page in its own slot of the page
+#define COUNTER_OFFSET 64
+
+// state shared with one worker thread
+typedef struct Worker {
+	BM_BufferPool *bm;
+	char *label;
+	int id;
+	int prefetch;
+	int failed;
+	int updates[NUM_PAGES];
+} Worker;
+
+// test methods
+static void testConcurrentPins (ReplacementStrategy strategy, int dirtyPercent, char *name);
+static void testSharedPool (void);
+static void testSharedFile (void);
+static void testConcurrentResize (ReplacementStrategy strategy, char *name);
+static void testScanRing (ReplacementStrategy strategy, char *name);
+static void testPrefetch (ReplacementStrategy strategy, char *name);
+static void testConcurrentHits (ReplacementStrategy strategy, char *name);
+static void testBackgroundWriter (ReplacementStrategy strategy, char *name);
+static void testResizeInUse (void);
+
+// helper methods
+static void *pinWorker (void *arg);
+static void *hitWorker (void *arg);
+static void *flushWorker (void *arg);
+static RC gatedWritePages (SM_FileHandle *fHandle, int startPage, int numPages, SM_PageHandle *memPages);
+static void createTestFile (char *fileName, char *label);
+static void checkTestFile (char *fileName, Worker *workers, int first, int step);
+
+// test name
+char *testName;
+
+// writes through gatedBackend wait until the gate opens, or 10 seconds
+static SM_Backend gatedBackend;
+static pthread_mutex_t gateLatch = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gateChanged = PTHREAD_COND_INITIALIZER;
+static int gateOpen;
+static int gateTimedOut;
+static int writesWaiting;
+
+// main method
+int
+main (void)
+{
+	testName = "";
+
+	initStorageManager();
+
+	testConcurrentPins(RS_FIFO, 0, "test concurrent pins with FIFO");
+	testConcurrentPins(RS_LRU, 0, "test concurrent pins with LRU");
+	testConcurrentPins(RS_CLOCK, 0, "test concurrent pins with CLOCK");
+	testConcurrentPins(RS_LFU, 0, "test concurrent pins with LFU");
+	testConcurrentPins(RS_LRU_K, 0, "test concurrent pins with LRU-K");
+	testConcurrentPins(RS_ARC, 0, "test concurrent pins with ARC");
+	testConcurrentPins(RS_CLOCK, 10, "test concurrent pins with CLOCK and a background writer");
+	testConcurrentPins(RS_ARC, 10, "test concurrent pins with ARC and a background writer");
+	testSharedPool();
+	testSharedFile();
+	testConcurrentResize(RS_FIFO, "test resizing a FIFO pool under concurrent pins");
+	testConcurrentResize(RS_LRU_K, "test resizing an LRU-K pool under concurrent pins");
+	testConcurrentResize(RS_ARC, "test resizing an ARC pool under concurrent pins");
+	testScanRing(RS_FIFO, "test a scan ring leaves the working set of a FIFO pool alone");
+	testScanRing(RS_LRU_K, "test a scan ring leaves the working set of an LRU-K pool alone");
+	testScanRing(RS_ARC, "test a scan ring leaves the working set of an ARC pool alone");
+	testPrefetch(RS_FIFO, "test prefetching pages into a FIFO pool");
+	testPrefetch(RS_LRU, "test prefetching pages into an LRU pool");
+	testPrefetch(RS_ARC, "test prefetching pages into an ARC pool");
+	testConcurrentHits(RS_FIFO, "test hits on a FIFO pool do not wait for a flush");
+	testConcurrentHits(RS_LRU, "test hits on an LRU pool do not wait for a flush");
+	testConcurrentHits(RS_CLOCK, "test hits on a CLOCK pool do not wait for a flush");
+	testConcurrentHits(RS_LFU, "test hits on an LFU pool do not wait for a flush");
+	testConcurrentHits(RS_LRU_K, "test hits on an LRU-K pool do not wait for a flush");
+	testConcurrentHits(RS_ARC, "test hits on an ARC pool do not wait for a flush");
+	testBackgroundWriter(RS_FIFO, "test the background writer cleans FIFO victims before they are evicted");
+	testBackgroundWriter(RS_LRU, "test the background writer cleans LRU victims before they are evicted");
+	testResizeInUse();
+
+	return 0;
+}
+
+// ************************************************************
+// several threads pin random pages of a pool much smaller than the file,
+// check them and update their own counters. After a flush every update has to
+// be on disk, no matter how often the page was evicted in between. With a
+// dirtyPercent above 0 a background writer cleans pages at the same time.
+void
+testConcurrentPins (ReplacementStrategy strategy, int dirtyPercent, char *name)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	pthread_t threads[NUM_THREADS];
+	Worker workers[NUM_THREADS];
+	int *fixCounts;
+	int i, t;
+
+	testName = name;
+
+	createTestFile("test_concurrent_pool.bin", "Page");
+
+	TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", NUM_FRAMES, strategy, NULL));
+	if (dirtyPercent > 0)
+		TEST_CHECK(startBackgroundWriter(bm, dirtyPercent));
+
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		memset(&workers[t], 0, sizeof(Worker));
+		workers[t].bm = bm;
+		workers[t].label = "Page";
+		workers[t].id = t;
+		ASSERT_TRUE(pthread_create(&threads[t], NULL, pinWorker, &workers[t]) == 0, "worker started");
+	}
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		ASSERT_EQUALS_INT(0, workers[t].failed, "worker saw only the pages it pinned");
+	}
+
+	fixCounts = getFixCounts(bm);
+	for (i = 0; i < NUM_FRAMES; i++)
+		if (fixCounts[i] != 0)
+			ASSERT_EQUALS_INT(0, fixCounts[i], "no page left pinned");
+	free(fixCounts);
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	// every update of every thread reached the disk
+	checkTestFile("test_concurrent_pool.bin", workers, 0, 1);
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+// two files share one pool, half of the threads work on each. Pages of one
+// file must never show up as pages of the other, and shutting down one handle
+// only writes and closes its own file.
+void
+testSharedPool (void)
+{
+	char *fileNames[2] = { "test_shared_pool_a.bin", "test_shared_pool_b.bin" };
+	char *labels[2] = { "A", "B" };
+	BM_BufferPool *pools[2];
+	pthread_t threads[NUM_THREADS];
+	Worker workers[NUM_THREADS];
+	int *fixCounts;
+	int f, i, t;
+
+	testName = "test concurrent pins on two files sharing a pool";
+
+	TEST_CHECK(initSharedBufferPool(NUM_FRAMES * PAGE_SIZE, RS_ARC, NULL));
+	for (f = 0; f < 2; f++)
+	{
+		createTestFile(fileNames[f], labels[f]);
+		pools[f] = MAKE_POOL();
+		TEST_CHECK(openSharedBufferPool(pools[f], fileNames[f]));
+		ASSERT_EQUALS_INT(NUM_FRAMES, pools[f]->numPages, "handle sees the whole pool");
+	}
+	ASSERT_EQUALS_INT(RC_BUFFER_POOL_IN_USE, shutdownSharedBufferPool(), "pool with open files stays");
+
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		memset(&workers[t], 0, sizeof(Worker));
+		workers[t].bm = pools[t % 2];
+		workers[t].label = labels[t % 2];
+		workers[t].id = t;
+		ASSERT_TRUE(pthread_create(&threads[t], NULL, pinWorker, &workers[t]) == 0, "worker started");
+	}
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		ASSERT_EQUALS_INT(0, workers[t].failed, "worker saw only the pages it pinned");
+	}
+
+	for (f = 0; f < 2; f++)
+	{
+		fixCounts = getFixCounts(pools[f]);
+		for (i = 0; i < NUM_FRAMES; i++)
+			if (fixCounts[i] != 0)
+				ASSERT_EQUALS_INT(0, fixCounts[i], "no page left pinned");
+		free(fixCounts);
+		TEST_CHECK(shutdownBufferPool(pools[f]));
+		checkTestFile(fileNames[f], workers, f, 2);
+		free(pools[f]);
+	}
+	TEST_CHECK(shutdownSharedBufferPool());
+
+	TEST_DONE();
+}
+
+// ************************************************************
+// the same file opened through two handles of a shared pool is cached once.
+// Both handles pin the same frame, an update through one is seen through the
+// other, and shutting one handle down leaves the file open for the other.
+void
+testSharedFile (void)
+{
+	BM_BufferPool *pools[2];
+	BM_PageHandle h[2];
+	SM_FileHandle fh;
+	char *page = (char *) calloc(PAGE_SIZE, 1);
+	int readIO, f;
+
+	testName = "test one file opened through two handles of a shared pool";
+
+	createTestFile("test_shared_file.bin", "Page");
+
+	TEST_CHECK(initSharedBufferPool(NUM_FRAMES * PAGE_SIZE, RS_ARC, NULL));
+	for (f = 0; f < 2; f++)
+	{
+		pools[f] = MAKE_POOL();
+		TEST_CHECK(openSharedBufferPool(pools[f], "test_shared_file.bin"));
+	}
+
+	TEST_CHECK(pinPage(pools[0], &h[0], 3));
+	TEST_CHECK(pinPage(pools[1], &h[1], 3));
+	ASSERT_TRUE(h[0].data == h[1].data, "both handles pin the same frame");
+	readIO = getNumReadIO(pools[0]);
+	ASSERT_EQUALS_INT(1, readIO, "page was read once");
+
+	sprintf(h[0].data, "Changed-3");
+	TEST_CHECK(markDirty(pools[0], &h[0]));
+	TEST_CHECK(unpinPage(pools[0], &h[0]));
+	ASSERT_EQUALS_STRING("Changed-3", h[1].data, "update is seen through the other handle");
+
+	// the pin through the other handle does not keep this one attached
+	TEST_CHECK(shutdownBufferPool(pools[0]));
+	TEST_CHECK(unpinPage(pools[1], &h[1]));
+	TEST_CHECK(pinPage(pools[1], &h[1], 3));
+	ASSERT_EQUALS_STRING("Changed-3", h[1].data, "page stays cached for the other handle");
+	readIO = getNumReadIO(pools[1]);
+	ASSERT_EQUALS_INT(1, readIO, "page was not read again");
+	TEST_CHECK(unpinPage(pools[1], &h[1]));
+	TEST_CHECK(shutdownBufferPool(pools[1]));
+	TEST_CHECK(shutdownSharedBufferPool());
+
+	// the update reached the disk
+	TEST_CHECK(openPageFile("test_shared_file.bin", &fh));
+	TEST_CHECK(readBlock(3, &fh, page));
+	ASSERT_EQUALS_STRING("Changed-3", page, "update is on disk");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile("test_shared_file.bin"));
+
+	for (f = 0; f < 2; f++)
+		free(pools[f]);
+	free(page);
+	TEST_DONE();
+}
+
+// ************************************************************
+// the pool grows and shrinks while the threads pin. Every thread holds one pin
+// at most, so a pool of more frames than threads can always shrink. Pages
+// must keep their contents and every update must reach the disk.
+void
+testConcurrentResize (ReplacementStrategy strategy, char *name)
+{
+	int sizes[] = { NUM_THREADS + 1, 4 * NUM_FRAMES, NUM_FRAMES / 2, 2 * NUM_FRAMES };
+	BM_BufferPool *bm = MAKE_POOL();
+	pthread_t threads[NUM_THREADS];
+	Worker workers[NUM_THREADS];
+	int *fixCounts;
+	int i, t;
+
+	testName = name;
+
+	createTestFile("test_concurrent_pool.bin", "Page");
+
+	TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", NUM_FRAMES, strategy, NULL));
+
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		memset(&workers[t], 0, sizeof(Worker));
+		workers[t].bm = bm;
+		workers[t].label = "Page";
+		workers[t].id = t;
+		ASSERT_TRUE(pthread_create(&threads[t], NULL, pinWorker, &workers[t]) == 0, "worker started");
+	}
+	for (i = 0; i < 200; i++)
+	{
+		TEST_CHECK(resizeBufferPool(bm, sizes[i % 4]));
+		ASSERT_EQUALS_INT(sizes[i % 4], bm->numPages, "handle has the new size");
+	}
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		ASSERT_EQUALS_INT(0, workers[t].failed, "worker saw only the pages it pinned");
+	}
+
+	fixCounts = getFixCounts(bm);
+	for (i = 0; i < bm->numPages; i++)
+		if (fixCounts[i] != 0)
+			ASSERT_EQUALS_INT(0, fixCounts[i], "no page left pinned");
+	free(fixCounts);
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	checkTestFile("test_concurrent_pool.bin", workers, 0, 1);
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+// a hot set fills part of a 50 frame pool, then a scan of the rest of the file
+// goes through a ring. The scan must see every page and the hot set must not
+// have to be read again.
+void
+testScanRing (ReplacementStrategy strategy, char *name)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_ScanRing ring;
+	BM_PageHandle h;
+	char expected[32];
+	int hotPages = 30;
+	int readIO, i;
+
+	testName = name;
+
+	createTestFile("test_concurrent_pool.bin", "Page");
+
+	TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", 50, strategy, NULL));
+	for (i = 0; i < 2 * hotPages; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i % hotPages));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+
+	TEST_CHECK(initScanRing(bm, &ring, 16));
+	ASSERT_EQUALS_INT(12, ring.numFrames, "ring takes a quarter of the pool at most");
+	for (i = hotPages; i < NUM_PAGES; i++)
+	{
+		TEST_CHECK(pinPageScan(bm, &ring, &h, i));
+		sprintf(expected, "Page-%i", i);
+		if (h.pageNum != i || strcmp(h.data, expected) != 0)
+			ASSERT_EQUALS_STRING(expected, h.data, "scan reads the right page");
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	TEST_CHECK(closeScanRing(&ring));
+	ASSERT_EQUALS_INT(NUM_PAGES, getNumReadIO(bm), "every page was read once");
+
+	// the hot set is still in the pool
+	readIO = getNumReadIO(bm);
+	for (i = 0; i < hotPages; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(readIO, getNumReadIO(bm), "hot set survived the scan");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("test_concurrent_pool.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+// prefetched pages are read once and then hit. After that every thread
+// prefetches the page it pins next, and every update must still reach the
+// disk.
+void
+testPrefetch (ReplacementStrategy strategy, char *name)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	pthread_t threads[NUM_THREADS];
+	Worker workers[NUM_THREADS];
+	PageNumber pageNums[NUM_FRAMES / 2];
+	BM_PageHandle h;
+	char expected[32];
+	int i, t;
+
+	testName = name;
+
+	createTestFile("test_concurrent_pool.bin", "Page");
+
+	TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", NUM_FRAMES, strategy, NULL));
+	for (i = 0; i < NUM_FRAMES / 2; i++)
+		pageNums[i] = 3 * i;
+	TEST_CHECK(prefetchPages(bm, pageNums, NUM_FRAMES / 2));
+	for (i = 0; i < NUM_FRAMES / 2; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, pageNums[i]));
+		sprintf(expected, "Page-%i", pageNums[i]);
+		ASSERT_EQUALS_STRING(expected, h.data, "prefetched page has its contents");
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(NUM_FRAMES / 2, getNumReadIO(bm), "every prefetched page was read once");
+
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		memset(&workers[t], 0, sizeof(Worker));
+		workers[t].bm = bm;
+		workers[t].label = "Page";
+		workers[t].id = t;
+		workers[t].prefetch = 1;
+		ASSERT_TRUE(pthread_create(&threads[t], NULL, pinWorker, &workers[t]) == 0, "worker started");
+	}
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		ASSERT_EQUALS_INT(0, workers[t].failed, "worker saw only the pages it pinned");
+	}
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	checkTestFile("test_concurrent_pool.bin", workers, 0, 1);
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+// a flush of a cold page is held up inside its write while the threads hit
+// the rest of the pool. Hits neither read a page nor wait for the pool latch,
+// so they all finish before the write does. The references they made still
+// count once the pool picks a victim: the cold page goes first.
+void
+testConcurrentHits (ReplacementStrategy strategy, char *name)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	pthread_t threads[NUM_THREADS];
+	pthread_t flusher;
+	Worker workers[NUM_THREADS];
+	Worker flush;
+	BM_PageHandle h;
+	struct timespec deadline;
+	int *fixCounts;
+	int readIO, i, t;
+
+	testName = name;
+
+	createTestFile("test_concurrent_pool.bin", "Page");
+
+	gatedBackend = SM_PosixBackend;
+	gatedBackend.writePages = gatedWritePages;
+	gateOpen = 0;
+	gateTimedOut = 0;
+	writesWaiting = 0;
+	setStorageBackend(&gatedBackend);
+
+	// the cold page comes first and is dirty, the hot pages fill the rest
+	TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", NUM_FRAMES, strategy, NULL));
+	TEST_CHECK(pinPage(bm, &h, NUM_PAGES - 1));
+	TEST_CHECK(markDirty(bm, &h));
+	TEST_CHECK(unpinPage(bm, &h));
+	for (i = 0; i < NUM_FRAMES - 1; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	readIO = getNumReadIO(bm);
+
+	// wait until the flush is writing the cold page
+	memset(&flush, 0, sizeof(Worker));
+	flush.bm = bm;
+	ASSERT_TRUE(pthread_create(&flusher, NULL, flushWorker, &flush) == 0, "flush started");
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 10;
+	pthread_mutex_lock(&gateLatch);
+	while (writesWaiting == 0 && pthread_cond_timedwait(&gateChanged, &gateLatch, &deadline) == 0)
+		;
+	t = writesWaiting;
+	pthread_mutex_unlock(&gateLatch);
+	ASSERT_TRUE(t > 0, "flush is writing");
+
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		memset(&workers[t], 0, sizeof(Worker));
+		workers[t].bm = bm;
+		workers[t].label = "Page";
+		workers[t].id = t;
+		ASSERT_TRUE(pthread_create(&threads[t], NULL, hitWorker, &workers[t]) == 0, "worker started");
+	}
+	for (t = 0; t < NUM_THREADS; t++)
+	{
+		pthread_join(threads[t], NULL);
+		ASSERT_EQUALS_INT(0, workers[t].failed, "worker saw only the pages it pinned");
+	}
+
+	pthread_mutex_lock(&gateLatch);
+	ASSERT_EQUALS_INT(0, gateTimedOut, "hits finished while the flush was writing");
+	gateOpen = 1;
+	pthread_cond_broadcast(&gateChanged);
+	pthread_mutex_unlock(&gateLatch);
+	pthread_join(flusher, NULL);
+	ASSERT_EQUALS_INT(0, flush.failed, "flush wrote the cold page");
+	ASSERT_EQUALS_INT(readIO, getNumReadIO(bm), "hits read no page");
+
+	fixCounts = getFixCounts(bm);
+	for (i = 0; i < NUM_FRAMES; i++)
+		if (fixCounts[i] != 0)
+			ASSERT_EQUALS_INT(0, fixCounts[i], "no page left pinned");
+	free(fixCounts);
+
+	// a miss evicts the cold page, the hot pages stay
+	TEST_CHECK(pinPage(bm, &h, NUM_FRAMES - 1));
+	TEST_CHECK(unpinPage(bm, &h));
+	for (i = 0; i < NUM_FRAMES - 1; i++)
+	{
+		TEST_CHECK(pinPage(bm, &h, i));
+		TEST_CHECK(unpinPage(bm, &h));
+	}
+	ASSERT_EQUALS_INT(readIO + 1, getNumReadIO(bm), "hot pages stayed in the pool");
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	setStorageBackend(&SM_PosixBackend);
+	TEST_CHECK(destroyPageFile("test_concurrent_pool.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+// one thread dirties every frame of the pool and then reads as many other
+// pages, which evicts all of them. Without a writer every eviction writes a
+// page. With one, the writer starts once a quarter of the frames are dirty
+// and has written pages before the first eviction, so fewer evictions write.
+void
+testBackgroundWriter (ReplacementStrategy strategy, char *name)
+{
+	int dirtyPercents[] = { 0, 25 };
+	int dirtyEvictions[2];
+	struct timespec pause = { 0, 1000000L };
+	BM_BufferPool *bm = MAKE_POOL();
+	Worker worker;
+	BM_PageHandle h;
+	int counter, writeIO, waited, i, run;
+
+	testName = name;
+
+	for (run = 0; run < 2; run++)
+	{
+		createTestFile("test_concurrent_pool.bin", "Page");
+		memset(&worker, 0, sizeof(Worker));
+
+		TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", NUM_FRAMES, strategy, NULL));
+		if (dirtyPercents[run] > 0)
+			TEST_CHECK(startBackgroundWriter(bm, dirtyPercents[run]));
+
+		for (i = 0; i < NUM_FRAMES; i++)
+		{
+			TEST_CHECK(pinPage(bm, &h, i));
+			memcpy(&counter, h.data + COUNTER_OFFSET, sizeof(int));
+			counter++;
+			memcpy(h.data + COUNTER_OFFSET, &counter, sizeof(int));
+			worker.updates[i]++;
+			TEST_CHECK(markDirty(bm, &h));
+			TEST_CHECK(unpinPage(bm, &h));
+		}
+
+		// wait until the writer is down to half of its threshold, 10 seconds at most
+		writeIO = getNumWriteIO(bm);
+		for (waited = 0; dirtyPercents[run] > 0 && waited < 10000; waited++)
+		{
+			writeIO = getNumWriteIO(bm);
+			if (writeIO >= NUM_FRAMES - NUM_FRAMES * dirtyPercents[run] / 200)
+				break;
+			nanosleep(&pause, NULL);
+		}
+		if (dirtyPercents[run] > 0)
+			ASSERT_TRUE(writeIO > 0, "writer wrote pages");
+		else
+			ASSERT_EQUALS_INT(0, writeIO, "no page written without a writer");
+		i = getNumDirtyEvictions(bm);
+		ASSERT_EQUALS_INT(0, i, "no page evicted yet");
+
+		for (i = NUM_FRAMES; i < 2 * NUM_FRAMES; i++)
+		{
+			TEST_CHECK(pinPage(bm, &h, i));
+			TEST_CHECK(unpinPage(bm, &h));
+		}
+		dirtyEvictions[run] = getNumDirtyEvictions(bm);
+
+		TEST_CHECK(stopBackgroundWriter(bm));
+		TEST_CHECK(shutdownBufferPool(bm));
+		checkTestFile("test_concurrent_pool.bin", &worker, 0, NUM_THREADS);
+	}
+
+	ASSERT_EQUALS_INT(NUM_FRAMES, dirtyEvictions[0], "every eviction wrote a page without a writer");
+	ASSERT_TRUE(dirtyEvictions[1] < dirtyEvictions[0], "writer saved evictions a write");
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+// a pool whose pages are all pinned cannot shrink. The resize fails, the
+// handle keeps its size and the pinned pages keep their contents.
+void
+testResizeInUse (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle h[NUM_THREADS];
+	char expected[32];
+	RC rc;
+	int i;
+
+	testName = "test shrinking a pool below its pinned pages fails";
+
+	createTestFile("test_concurrent_pool.bin", "Page");
+
+	TEST_CHECK(initBufferPool(bm, "test_concurrent_pool.bin", NUM_THREADS, RS_LRU, NULL));
+	for (i = 0; i < NUM_THREADS; i++)
+		TEST_CHECK(pinPage(bm, &h[i], i));
+
+	rc = resizeBufferPool(bm, NUM_THREADS / 2);
+	ASSERT_EQUALS_INT(RC_BUFFER_POOL_IN_USE, rc, "pool with every page pinned does not shrink");
+	ASSERT_EQUALS_INT(NUM_THREADS, bm->numPages, "handle keeps its size");
+
+	for (i = 0; i < NUM_THREADS; i++)
+	{
+		sprintf(expected, "Page-%i", i);
+		ASSERT_EQUALS_STRING(expected, h[i].data, "pinned page keeps its contents");
+		TEST_CHECK(unpinPage(bm, &h[i]));
+	}
+
+	TEST_CHECK(shutdownBufferPool(bm));
+	TEST_CHECK(destroyPageFile("test_concurrent_pool.bin"));
+
+	free(bm);
+	TEST_DONE();
+}
+
+// ************************************************************
+void *
+pinWorker (void *arg)
+{
+	Worker *worker = (Worker *) arg;
+	BM_PageHandle h;
+	unsigned int seed = worker->id + 1;
+	char expected[32];
+	int pageNum, nextPage, counter, i;
+
+	// half of the pins go to a small hot set, the rest anywhere
+	nextPage = (rand_r(&seed) % 2) ? rand_r(&seed) % 16 : rand_r(&seed) % NUM_PAGES;
+
+	for (i = 0; i < NUM_OPS; i++)
+	{
+		// a worker that prefetches knows its next page one pin ahead
+		pageNum = nextPage;
+		nextPage = (rand_r(&seed) % 2) ? rand_r(&seed) % 16 : rand_r(&seed) % NUM_PAGES;
+		if (worker->prefetch)
+			prefetchPages(worker->bm, &nextPage, 1);
+
+		if (pinPage(worker->bm, &h, pageNum) != RC_OK)
+		{
+			worker->failed++;
+			continue;
+		}
+
+		sprintf(expected, "%s-%i", worker->label, pageNum);
+		if (h.pageNum != pageNum || strcmp(h.data, expected) != 0)
+			worker->failed++;
+
+		// every other pin updates the counter of this thread
+		if (rand_r(&seed) % 2)
+		{
+			memcpy(&counter, h.data + COUNTER_OFFSET + worker->id * sizeof(int), sizeof(int));
+			counter++;
+			memcpy(h.data + COUNTER_OFFSET + worker->id * sizeof(int), &counter, sizeof(int));
+			worker->updates[pageNum]++;
+			markDirty(worker->bm, &h);
+		}
+
+		unpinPage(worker->bm, &h);
+	}
+
+	return NULL;
+}
+
+// ************************************************************
+// pins and unpins pages of the hot set of testConcurrentHits, which are all
+// in the pool
+void *
+hitWorker (void *arg)
+{
+	Worker *worker = (Worker *) arg;
+	BM_PageHandle h;
+	unsigned int seed = worker->id + 1;
+	char expected[32];
+	int pageNum, i;
+
+	for (i = 0; i < NUM_OPS; i++)
+	{
+		pageNum = rand_r(&seed) % (NUM_FRAMES - 1);
+		if (pinPage(worker->bm, &h, pageNum) != RC_OK)
+		{
+			worker->failed++;
+			continue;
+		}
+		sprintf(expected, "%s-%i", worker->label, pageNum);
+		if (h.pageNum != pageNum || strcmp(h.data, expected) != 0)
+			worker->failed++;
+		unpinPage(worker->bm, &h);
+	}
+
+	return NULL;
+}
+
+// ************************************************************
+void *
+flushWorker (void *arg)
+{
+	Worker *worker = (Worker *) arg;
+
+	if (forceFlushPool(worker->bm) != RC_OK)
+		worker->failed++;
+	return NULL;
+}
+
+// ************************************************************
+// writes of gatedBackend wait for the gate, a write that waited 10 seconds
+// goes ahead and leaves gateTimedOut set
+RC
+gatedWritePages (SM_FileHandle *fHandle, int startPage, int numPages, SM_PageHandle *memPages)
+{
+	struct timespec deadline;
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += 10;
+
+	pthread_mutex_lock(&gateLatch);
+	writesWaiting++;
+	pthread_cond_broadcast(&gateChanged);
+	while (!gateOpen && pthread_cond_timedwait(&gateChanged, &gateLatch, &deadline) == 0)
+		;
+	if (!gateOpen)
+		gateTimedOut = 1;
+	writesWaiting--;
+	pthread_mutex_unlock(&gateLatch);
+
+	return SM_PosixBackend.writePages(fHandle, startPage, numPages, memPages);
+}
+
+// ************************************************************
+// every page starts with its label and page number and all counters at zero
+void
+createTestFile (char *fileName, char *label)
+{
+	SM_FileHandle fh;
+	char *page = (char *) calloc(PAGE_SIZE, 1);
+	int i;
+
+	TEST_CHECK(createPageFile(fileName));
+	TEST_CHECK(openPageFile(fileName, &fh));
+	TEST_CHECK(ensureCapacity(NUM_PAGES, &fh));
+	for (i = 0; i < NUM_PAGES; i++)
+	{
+		sprintf(page, "%s-%i", label, i);
+		TEST_CHECK(writeBlock(i, &fh, page));
+	}
+	TEST_CHECK(closePageFile(&fh));
+	free(page);
+}
+
+// ************************************************************
+// compare the counters on disk with the updates of the workers first,
+// first + step, ... and destroy the file
+void
+checkTestFile (char *fileName, Worker *workers, int first, int step)
+{
+	SM_FileHandle fh;
+	char *page = (char *) calloc(PAGE_SIZE, 1);
+	int counter, expected, i, t;
+
+	TEST_CHECK(openPageFile(fileName, &fh));
+	for (i = 0; i < NUM_PAGES; i++)
+	{
+		TEST_CHECK(readBlock(i, &fh, page));
+		for (t = first; t < NUM_THREADS; t += step)
+		{
+			memcpy(&counter, page + COUNTER_OFFSET + t * sizeof(int), sizeof(int));
+			expected = workers[t].updates[i];
+			if (counter != expected)
+				ASSERT_EQUALS_INT(expected, counter, "update count on disk");
+		}
+	}
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile(fileName));
+	free(page);
+}
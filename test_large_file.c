@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "test_helper.h"
+
+// first page that starts beyond the 4 GB mark
+#define PAGE_PAST_4GB ((int) ((4LL * 1024 * 1024 * 1024) / PAGE_SIZE))
+
+// test methods
+static void testStoragePast4GB (void);
+static void testBufferPoolPast4GB (void);
+
+// helper methods
+static void fillPage (char *page, int pageNum);
+static void checkPage (char *page, int pageNum);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+	testName = "";
+
+	initStorageManager();
+
+	testStoragePast4GB();
+	testBufferPoolPast4GB();
+
+	return 0;
+}
+
+// ************************************************************
+// write pages on both sides of the 2 GB and 4 GB marks and read them back
+void
+testStoragePast4GB (void)
+{
+	SM_FileHandle fh;
+	char *page = (char *) malloc(PAGE_SIZE);
+	int pages[] = {
+			PAGE_PAST_4GB / 2 - 1,
+			PAGE_PAST_4GB / 2,
+			PAGE_PAST_4GB - 1,
+			PAGE_PAST_4GB,
+			PAGE_PAST_4GB + 1000
+	};
+	int numPages = 5, i;
+
+	testName = "test writing and reading pages past the 4 GB mark";
+
+	TEST_CHECK(createPageFile("test_large_file.bin"));
+	TEST_CHECK(openPageFile("test_large_file.bin", &fh));
+
+	// grow the file past 4 GB, the skipped pages stay sparse
+	TEST_CHECK(ensureCapacity(PAGE_PAST_4GB + 1001, &fh));
+	ASSERT_EQUALS_INT(PAGE_PAST_4GB + 1001, fh.totalNumPages, "file grew past 4 GB");
+
+	for (i = 0; i < numPages; i++)
+	{
+		fillPage(page, pages[i]);
+		TEST_CHECK(writeBlock(pages[i], &fh, page));
+	}
+	TEST_CHECK(closePageFile(&fh));
+
+	// reopen so the page count comes from the file size
+	TEST_CHECK(openPageFile("test_large_file.bin", &fh));
+	ASSERT_EQUALS_INT(PAGE_PAST_4GB + 1001, fh.totalNumPages, "page count after reopen");
+
+	for (i = 0; i < numPages; i++)
+	{
+		TEST_CHECK(readBlock(pages[i], &fh, page));
+		checkPage(page, pages[i]);
+	}
+
+	// the last page is still the last one we wrote
+	TEST_CHECK(readLastBlock(&fh, page));
+	checkPage(page, PAGE_PAST_4GB + 1000);
+
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile("test_large_file.bin"));
+
+	free(page);
+	TEST_DONE();
+}
+
+// ************************************************************
+// pin, modify and flush pages past 4 GB through the buffer pool
+void
+testBufferPoolPast4GB (void)
+{
+	BM_BufferPool *bm = MAKE_POOL();
+	BM_PageHandle *h = MAKE_PAGE_HANDLE();
+	SM_FileHandle fh;
+	char *page = (char *) malloc(PAGE_SIZE);
+	int i;
+
+	testName = "test pinning pages past the 4 GB mark";
+
+	TEST_CHECK(createPageFile("test_large_file.bin"));
+	TEST_CHECK(initBufferPool(bm, "test_large_file.bin", 3, RS_FIFO, NULL));
+
+	// more pages than frames, so some of them are evicted on the way
+	for (i = 0; i < 6; i++)
+	{
+		TEST_CHECK(pinPage(bm, h, PAGE_PAST_4GB + i));
+		fillPage(h->data, PAGE_PAST_4GB + i);
+		TEST_CHECK(markDirty(bm, h));
+		TEST_CHECK(unpinPage(bm, h));
+	}
+	TEST_CHECK(shutdownBufferPool(bm));
+
+	TEST_CHECK(openPageFile("test_large_file.bin", &fh));
+	for (i = 0; i < 6; i++)
+	{
+		TEST_CHECK(readBlock(PAGE_PAST_4GB + i, &fh, page));
+		checkPage(page, PAGE_PAST_4GB + i);
+	}
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile("test_large_file.bin"));
+
+	free(page);
+	free(bm);
+	free(h);
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+fillPage (char *page, int pageNum)
+{
+	int i;
+
+	for (i = 0; i < PAGE_SIZE; i++)
+		page[i] = (char) ((pageNum + i) % 128);
+	sprintf(page, "%i", pageNum);
+}
+
+void
+checkPage (char *page, int pageNum)
+{
+	char expected[PAGE_SIZE];
+
+	fillPage(expected, pageNum);
+	ASSERT_TRUE(memcmp(expected, page, PAGE_SIZE) == 0, "page contents match");
+}